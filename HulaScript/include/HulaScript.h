@@ -10,6 +10,12 @@
 #include <string>
 #include <memory>
 #include <optional>
+#include <span>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <typeinfo>
 #include "btree.h"
 #include "phmap.h"
 #include "source_loc.h"
@@ -27,6 +33,7 @@ namespace HulaScript {
 			enum vtype : uint8_t {
 				NIL,
 				NUMBER,
+				RATIONAL,
 				BOOLEAN,
 				STRING,
 				TABLE,
@@ -63,6 +70,12 @@ namespace HulaScript {
 				size_t id;
 				char* str;
 				foreign_object* foreign_object;
+
+				//lowest terms, with a positive denominator, so equal rationals have equal bits
+				struct {
+					int32_t numerator;
+					uint32_t denominator;
+				} rational;
 			} data;
 
 			value(char* str) : type(vtype::STRING), flags(flags::NONE), function_id(0), data({ .str = str }) { }
@@ -71,6 +84,8 @@ namespace HulaScript {
 
 			value(foreign_object* foreign_object) : type(vtype::FOREIGN_OBJECT), flags(flags::NONE), function_id(0), data({ .foreign_object = foreign_object }){ }
 
+			value(int32_t numerator, uint32_t denominator) : type(vtype::RATIONAL), flags(flags::NONE), function_id(0), data({ .rational = { .numerator = numerator, .denominator = denominator } }) { }
+
 			friend class instance;
 		public:
 			value() : value(vtype::NIL, flags::NONE, 0, 0) { }
@@ -84,6 +99,9 @@ namespace HulaScript {
 				if (check_type(vtype::FOREIGN_OBJECT)) {
 					return data.foreign_object->to_number();
 				}
+				if (check_type(vtype::RATIONAL)) {
+					return static_cast<double>(data.rational.numerator) / static_cast<double>(data.rational.denominator);
+				}
 
 				expect_type(vtype::NUMBER, instance);
 				return data.number;
@@ -99,6 +117,11 @@ namespace HulaScript {
 				return data.foreign_object;
 			}
 
+			std::pair<int32_t, uint32_t> rational(instance& instance) const {
+				expect_type(vtype::RATIONAL, instance);
+				return std::make_pair(data.rational.numerator, data.rational.denominator);
+			}
+
 			const int64_t index(int64_t min, int64_t max, instance& instance) const;
 
 			const constexpr size_t hash() const {
@@ -117,6 +140,8 @@ namespace HulaScript {
 					[[fallthrough]];
 				case vtype::INTERNAL_TABLE_GET_ITERATOR:
 					[[fallthrough]];
+				case vtype::RATIONAL:
+					[[fallthrough]];
 				case vtype::NUMBER:
 					payload = data.id;
 					break;
@@ -158,7 +183,8 @@ namespace HulaScript {
 				return value();
 			}
 			
-			virtual value call_method(uint32_t method_id, std::vector<value>& arguments, instance& instance) {
+			//arguments are only valid until the method calls back into the instance
+			virtual value call_method(uint32_t method_id, std::span<const value> arguments, instance& instance) {
 				return value();
 			}
 
@@ -169,6 +195,8 @@ namespace HulaScript {
 			virtual value modulo_operator(value& operand, instance& instance) { return value(); }
 			virtual value exponentiate_operator(value& operand, instance& instance) { return value(); }
 
+			//must report the same values for the object's whole life; minor collections don't rescan old objects
+			//the parallel marker may trace different objects on different threads at once, so this must only read the object
 			virtual void trace(std::vector<value>& to_trace) { }
 			virtual std::string to_string() { return "Untitled Foreign Object"; }
 			virtual double to_number() { return NAN; }
@@ -177,51 +205,89 @@ namespace HulaScript {
 				return (size_t)this;
 			}
 
+			//whether load_property resolves a name to the same method id for every object of this type, which lets LOAD_TABLE cache it per type
+			virtual bool has_shared_properties() {
+				return false;
+			}
+
+			//bytes the object keeps allocated, itself included, to pace collections; read when the object is added, and again
+			//by every full collection it survives, so it should be cheap
+			virtual size_t memory_footprint() {
+				return 0;
+			}
+
 			friend class instance;
+		private:
+			bool tenured = false; //survived a collection
+			bool marked = false; //reached by the full collection in progress
+			size_t footprint = 0;
+
 		public:
 			virtual ~foreign_object() = default;
 		};
 
+		//arguments point into the evaluation stack, so they're only valid until the function calls back into the instance
+		typedef value(*foreign_function)(std::span<const value> arguments, instance& instance);
+
 		typedef value(*custom_numerical_parser)(std::string numerical_str, instance& instance);
 
+		//wraps a reduced fraction too wide to be stored inline; must always return a foreign object
+		typedef value(*custom_rational_spiller)(int64_t numerator, uint64_t denominator, instance& instance);
+
 		std::variant<value, std::vector<compilation_error>, std::monostate> run(std::string source, std::optional<std::string> file_name, bool repl_mode = true, bool ignore_warnings=false);
 		std::optional<value> run_loaded();
 
 		std::string get_value_print_string(value to_print);
 
 		value add_foreign_object(std::unique_ptr<foreign_object>&& foreign_obj) {
+			foreign_obj->footprint = foreign_obj->memory_footprint();
+			foreign_bytes += foreign_obj->footprint;
+
 			value to_ret = value(foreign_obj.get());
+			young_foreign_objs.push_back(foreign_obj.get());
+			shade(to_ret);
+			allocations_since_slice++;
 			foreign_objs.insert(std::move(foreign_obj));
 			return to_ret;
 		}
 
-		value make_foreign_function(std::function<value(std::vector<value>& arguments, instance& instance)> function) {
+		//small rationals are stored inline, anything wider goes through the rational spiller
+		value make_rational(int64_t numerator, uint64_t denominator);
+
+		value make_foreign_function(foreign_function function) {
 			uint32_t id;
 			if (availible_foreign_function_ids.empty()) {
 				id = static_cast<uint32_t>(foreign_functions.size());
+				foreign_functions.push_back(function);
 			}
 			else {
 				id = availible_foreign_function_ids.back();
 				availible_foreign_function_ids.pop_back();
+				foreign_functions[id] = function;
 			}
-			foreign_functions.insert({ id, function });
-			return value(value::vtype::FOREIGN_FUNCTION, value::flags::NONE, id, 0);
+			value to_ret = value(value::vtype::FOREIGN_FUNCTION, value::flags::NONE, id, 0);
+			shade(to_ret);
+			return to_ret;
 		}
 
 		value make_string(std::string str) {
-			auto res = active_strs.insert(std::unique_ptr<char[]>(new char[str.size() + 1]));
-			std::strcpy(res.first->get(), str.c_str());
-			return value(res.first->get());
+			char* allocated = allocate_string(str.size());
+			std::strcpy(allocated, str.c_str());
+			shade(value(allocated));
+			return value(allocated);
 		}
 
 		value make_table_obj(const std::vector<std::pair<std::string, value>>& elems, bool is_final=false) {
 			size_t table_id = allocate_table(elems.size(), false);
 			table& table = tables.at(table_id);
 			for (size_t i = 0; i < elems.size(); i++) {
-				table.key_hashes.insert({ Hash::dj2b(elems[i].first.c_str()), i });
+				value key(value::vtype::INTERNAL_STRHASH, value::flags::NONE, 0, Hash::dj2b(elems[i].first.c_str()));
+				if (!find_hash(table, key.data.id).has_value()) {
+					insert_key(table, key, key.data.id);
+				}
 				heap[table.block.start + i] = elems[i].second;
+				table.count++;
 			}
-			table.count = elems.size();
 
 			return value(value::vtype::TABLE, is_final ? value::flags::NONE : value::flags::TABLE_IS_FINAL, 0, table_id);
 		}
@@ -230,15 +296,54 @@ namespace HulaScript {
 			size_t table_id = allocate_table(elems.size(), false);
 			table& table = tables.at(table_id);
 			for (size_t i = 0; i < elems.size(); i++) {
-				value index_val(static_cast<double>(i));
-				table.key_hashes.insert({ index_val.hash(), i });
 				heap[table.block.start + i] = elems[i];
 			}
 			table.count = elems.size();
+			table.array_count = elems.size();
 
 			return value(value::vtype::TABLE, is_final ? value::flags::NONE : value::flags::TABLE_IS_FINAL, 0, table_id);
 		}
 
+		struct inline_cache_stats {
+			size_t hits;
+			size_t misses;
+		};
+
+		struct gc_stats {
+			size_t foreign_bytes; //retained by all foreign objects, as of when each last reported its footprint
+			size_t full_collections; //completed since the instance was made
+			size_t parallel_marks; //times marking ran on several threads
+		};
+
+		//the longest a single slice of an incremental collection may run for
+		void set_gc_slice_budget(std::chrono::microseconds budget) noexcept {
+			gc_slice_budget = budget;
+		}
+
+		//threads that mark when marking has to finish without a deadline and there's a lot left gray, the calling thread
+		//included; with more than one, cycles that begin with many promoted slots are marked in one go rather than in slices
+		void set_gc_mark_threads(size_t threads) noexcept {
+			gc_mark_threads = threads > 0 ? threads : 1;
+		}
+
+		//how many bytes foreign objects may allocate between collections
+		void set_gc_heap_budget(size_t bytes) noexcept {
+			foreign_bytes_limit = foreign_bytes_limit - gc_heap_budget + bytes;
+			gc_heap_budget = bytes;
+		}
+
+		size_t get_foreign_bytes() const noexcept {
+			return foreign_bytes;
+		}
+
+		inline_cache_stats get_inline_cache_stats() const noexcept {
+			return { .hits = inline_cache_hits, .misses = inline_cache_misses };
+		}
+
+		gc_stats get_gc_stats() const noexcept {
+			return { .foreign_bytes = foreign_bytes, .full_collections = full_collections, .parallel_marks = parallel_marks };
+		}
+
 		value invoke_value(value to_call, std::vector<value> arguments);
 		value invoke_method(value object, std::string method_name, std::vector<value> arguments);
 
@@ -271,7 +376,7 @@ namespace HulaScript {
 			throw runtime_error(msg, call_stack);
 		}
 
-		instance(custom_numerical_parser numerical_parser);
+		instance(custom_numerical_parser numerical_parser, custom_rational_spiller rational_spiller = NULL);
 		instance();
 	private:
 
@@ -339,7 +444,15 @@ namespace HulaScript {
 			RETURN,
 
 			CAPTURE_FUNCPTR, //captures a closure without a capture table
-			CAPTURE_CLOSURE
+			CAPTURE_CLOSURE,
+
+			//superinstructions, fused in place by peephole_optimize; the instructions each one stands for are left behind it
+			LOAD_LOCAL_ADD_CONST, //LOAD_LOCAL, LOAD_CONSTANT_FAST, ADD
+			STORE_LOCAL_DISCARD, //STORE_LOCAL, DISCARD_TOP
+			STORE_TABLE_DISCARD, //STORE_TABLE, DISCARD_TOP
+			INVOKE_PROPERTY, //LOAD_TABLE, CALL
+
+			HALT //ends execute(); appended after every block of top level code
 		};
 
 		struct instruction
@@ -355,12 +468,70 @@ namespace HulaScript {
 			gc_block(size_t start, size_t capacity) : start(start), capacity(capacity) { }
 		};
 
+		//one mark bit per id; ids past the end read as unmarked, and marking one grows the bitmap
+		struct mark_bitmap {
+			std::vector<uint64_t> words;
+
+			void clear() noexcept {
+				std::fill(words.begin(), words.end(), 0);
+			}
+
+			bool is_marked(size_t id) const noexcept {
+				size_t word = id / 64;
+				return word < words.size() && ((words[word] >> (id % 64)) & 1);
+			}
+
+			//makes room for ids below count, which concurrent marking can't do itself
+			void cover(size_t count) {
+				if (words.size() < (count + 63) / 64) {
+					words.resize((count + 63) / 64, 0);
+				}
+			}
+
+			//returns whether the id was unmarked
+			template<bool concurrent = false>
+			bool mark(size_t id) {
+				size_t word = id / 64;
+				uint64_t bit = static_cast<uint64_t>(1) << (id % 64);
+
+				if constexpr (concurrent) {
+					return !(std::atomic_ref<uint64_t>(words[word]).fetch_or(bit, std::memory_order_relaxed) & bit);
+				}
+				else {
+					if (word >= words.size()) {
+						words.resize(word + 1, 0);
+					}
+					if (words[word] & bit) {
+						return false;
+					}
+					words[word] |= bit;
+					return true;
+				}
+			}
+		};
+
+		//the property layout shared by every table that had the same names added in the same order; never freed
+		struct shape {
+			phmap::flat_hash_map<size_t, size_t> key_hashes;
+			phmap::flat_hash_map<size_t, shape*> transitions; //to the shapes with one more property
+		};
+
 		struct table {
 			gc_block block;
 			size_t count;
+
+			//keys 0 to array_count - 1 are stored at the same index of block, and have no entry in key_hashes
+			size_t array_count = 0;
+
+			//resolves property names until the table is given any other kind of key, or too many of them,
+			//at which point it is set to NULL and the table keeps a key_hashes of its own from then on
+			shape* layout;
 			phmap::btree_map<size_t, size_t> key_hashes;
 
-			table(gc_block block, size_t count=0) : block(block), count(count) { }
+			bool tenured = false; //survived a collection
+			bool remembered = false; //tenured, and given a value that may be young since the last minor collection
+
+			table(gc_block block, shape* layout, size_t count=0) : block(block), count(count), layout(layout) { }
 		};
 
 		struct function_entry {
@@ -375,6 +546,9 @@ namespace HulaScript {
 			//other function id's that are referenced in any instruction between start_address and start_address + length
 			std::vector<uint32_t> referenced_functions;
 			std::vector<uint32_t> referenced_constants;
+
+			//set once a collection reaches a closure of it; the functions a statement declared that never were are freed with it
+			bool tenured = false;
 		};
 
 		static operator_handler operator_handlers[(opcode::EXPONENTIATE - opcode::ADD) + 1][(value::vtype::FOREIGN_OBJECT - value::vtype::NUMBER) + 1][(value::vtype::FOREIGN_OBJECT - value::vtype::NUMBER) + 1];
@@ -385,6 +559,20 @@ namespace HulaScript {
 		void handle_numerical_modulo(value& a, value& b);
 		void handle_numerical_exponentiate(value& a, value& b);
 
+		void handle_rational_add(value& a, value& b);
+		void handle_rational_subtract(value& a, value& b);
+		void handle_rational_multiply(value& a, value& b);
+		void handle_rational_divide(value& a, value& b);
+
+		//everything else a rational does is left to the host's precise number type
+		value spill_rational(value& rational);
+		void handle_rational_spill_add(value& a, value& b);
+		void handle_rational_spill_subtract(value& a, value& b);
+		void handle_rational_spill_multiply(value& a, value& b);
+		void handle_rational_spill_divide(value& a, value& b);
+		void handle_rational_spill_modulo(value& a, value& b);
+		void handle_rational_spill_exponentiate(value& a, value& b);
+
 		void handle_string_add(value& a, value& b);
 
 		void handle_table_add(value& a, value& b);
@@ -410,16 +598,120 @@ namespace HulaScript {
 		phmap::flat_hash_set<std::unique_ptr<char[]>> active_strs;
 		phmap::flat_hash_set<std::unique_ptr<foreign_object>> foreign_objs;
 
-		phmap::flat_hash_map<uint32_t, std::function<value(std::vector<value>& arguments, instance& instance)>> foreign_functions;
+		std::vector<foreign_function> foreign_functions; //indexed by id; freed ids are NULL
 		std::vector<uint32_t> availible_foreign_function_ids;
 
-		phmap::btree_multimap<size_t, gc_block> free_blocks;
+		//Free blocks of the heap, segregated into power of two size classes: class k holds blocks of 2^k to 2^(k+1) - 1
+		//slots. Allocations pop a block from the smallest class whose blocks all fit, and split off what they don't need.
+		//Freed blocks are merged with free neighbours, and a free block at the end of the heap is trimmed off instead. The
+		//lists are stacks of block starts that may go stale once a block is merged or taken; free_block_starts is the truth.
+		static constexpr size_t size_classes = 64;
+		std::array<std::vector<size_t>, size_classes> free_lists;
+		size_t free_list_entries = 0;
+		phmap::flat_hash_map<size_t, size_t> free_block_starts; //start -> capacity
+		phmap::flat_hash_map<size_t, size_t> free_block_ends; //end -> start
 		phmap::flat_hash_map<size_t, table> tables;
 		std::vector<size_t> availible_table_ids;
 		size_t next_table_id = 0;
 
+		//Generational collection. Tables and foreign objects start out young, and a minor collection traces only young ones,
+		//from the roots plus the old tables in remembered_tables, then promotes whatever it reached and frees the rest.
+		//Old tables are only freed by a full collection, which runs once the old generation has doubled since the last one.
+		std::vector<size_t> young_tables;
+		std::vector<foreign_object*> young_foreign_objs;
+		std::vector<size_t> remembered_tables;
+		size_t promoted_slots = 0; //heap slots promoted by minor collections, or grown by old tables, since the last full collection
+		size_t live_slots = 0; //heap slots still in use after the last full collection
+
+		//Foreign objects report their footprint when added, since the bulk of their memory lies outside the heap. A
+		//collection starts at the next safe point once they've allocated gc_heap_budget bytes since the last one.
+		size_t foreign_bytes = 0; //retained by all foreign objects
+		size_t promoted_foreign_bytes = 0;
+		size_t live_foreign_bytes = 0;
+		size_t gc_heap_budget = 64 * 1024 * 1024;
+		size_t foreign_bytes_limit = 64 * 1024 * 1024;
+		size_t full_collections = 0;
+
+		static constexpr size_t nursery_size = 4096; //young foreign objects that trigger a minor collection at the next loop back edge
+		size_t nested_executions = 0; //invoke_value calls in progress; the host frames below them may hold unrooted values
+
+		//Full collections are incremental. Marking is tri-color: gray values are marked but not yet traced through. Objects
+		//allocated, and values stored into tables, while marking are shaded gray, and the roots are marked once more before
+		//sweeping, which runs in one go. Compaction then slides tables down in increments; blocks freed meanwhile are dropped
+		//rather than reused, since they lie in the region being compacted. Minor collections wait until a cycle is over.
+		enum class collection_phase {
+			IDLE,
+			MARKING,
+			COMPACTING
+		};
+		collection_phase gc_phase = collection_phase::IDLE;
+
+		//Tables, functions, constants and foreign functions are marked in bitmaps indexed by id, and foreign objects and
+		//strings carry their own mark bits, which the sweep clears on survivors. The bitmaps, gray stacks and traced_values
+		//keep their capacity between cycles, so marking allocates nothing once they've grown to fit the heap.
+		std::vector<value> gray_values; //marked tables and foreign objects that are yet to be traced through
+		std::vector<uint32_t> gray_functions;
+		std::vector<value> traced_values; //what the foreign object being traced references
+		mark_bitmap marked_tables;
+		mark_bitmap marked_functions;
+		mark_bitmap marked_constants;
+		mark_bitmap marked_foreign_functions;
+
+		//Marking without a deadline runs on several threads when the gray set holds enough to be worth starting them, and
+		//gc_slice drops the deadline once slices fall behind. Each thread owns a deque of gray values and steals from the
+		//others' when it runs dry; large tables are split into chunks of mark_chunk_slots, so one table's slots can be shared
+		//out too. Only the mark bits are written while marking.
+		size_t gc_mark_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+		size_t parallel_marks = 0;
+		static constexpr size_t parallel_mark_threshold = 1 << 16; //slots of gray tables, and gray foreign objects
+		static constexpr size_t mark_chunk_slots = 4096;
+
+		std::vector<std::pair<size_t, size_t>> compaction_queue; //table id and block start, by block start
+		size_t compaction_index = 0;
+		size_t compaction_offset = 0; //where the next table is moved to
+		size_t compaction_end = 0; //the heap size when compaction began
+
+		std::chrono::microseconds gc_slice_budget = std::chrono::microseconds(1000);
+		static constexpr size_t slice_allocations = 1024; //allocations between slices
+		size_t allocations_since_slice = 0;
+
+		static constexpr size_t max_shape_properties = 64;
+		std::vector<std::unique_ptr<shape>> shapes;
+		shape* empty_shape = shapes.emplace_back(std::make_unique<shape>()).get();
+
 		std::vector<value> evaluation_stack;
 
+		//LOAD_TABLE's inline caches for constant property names, picked by instruction address. Entries are keyed on the receiver
+		//and the name rather than the address, so an entry left behind by code that has since moved or been freed can only miss.
+		struct inline_cache {
+			static constexpr size_t ways = 4;
+
+			struct entry {
+				value::vtype receiver_type = value::vtype::NIL; //TABLE or FOREIGN_OBJECT; NIL marks an unused entry
+				size_t receiver = 0; //a table's shape, or a foreign object's type
+				size_t name_hash = 0;
+				uint32_t slot = 0; //an index into the table's block, or a method id
+			};
+
+			entry entries[ways];
+			uint8_t next_victim = 0;
+		};
+		static constexpr size_t inline_cache_sets = 256;
+		std::vector<inline_cache> inline_caches = std::vector<inline_cache>(inline_cache_sets);
+		size_t inline_cache_hits = 0;
+		size_t inline_cache_misses = 0;
+
+		void record_inline_cache(inline_cache& cache, value::vtype receiver_type, size_t receiver, size_t name_hash, uint32_t slot) noexcept {
+			for (auto& entry : cache.entries) {
+				if (entry.receiver_type == value::vtype::NIL) {
+					entry = { .receiver_type = receiver_type, .receiver = receiver, .name_hash = name_hash, .slot = slot };
+					return;
+				}
+			}
+			cache.entries[cache.next_victim] = { .receiver_type = receiver_type, .receiver = receiver, .name_hash = name_hash, .slot = slot };
+			cache.next_victim = (cache.next_victim + 1) % inline_cache::ways;
+		}
+
 		std::vector<value> heap; //where elements of tables are stored
 		std::vector<value> locals; //where local variables are stores
 		std::vector<value> globals; //where global variables are stored; max capacity of 256
@@ -428,6 +720,7 @@ namespace HulaScript {
 		std::vector<operand> extended_offsets; 
 
 		std::vector<size_t> return_stack;
+		size_t native_return_depth = 0; //RETURN hands control back to invoke_value, rather than the caller's code, at this return_stack size
 		size_t ip = 0;
 		std::vector<instruction> instructions;
 		phmap::btree_map<size_t, source_loc> ip_src_map;
@@ -435,6 +728,14 @@ namespace HulaScript {
 		phmap::flat_hash_map<uint32_t, function_entry> functions;
 		std::vector<uint32_t> availible_function_ids;
 
+		//What the statement being run added. Its top level code sits past every function it declared, starting at
+		//statement_start, so finalizing it only has to compact instructions from there on. Everything below is compacted once
+		//the functions full collections free there leave dead_instructions at over half of all instructions.
+		std::vector<uint32_t> young_functions;
+		std::vector<uint32_t> young_constants;
+		size_t statement_start = 0;
+		size_t dead_instructions = 0;
+
 		std::vector<uint32_t> repl_used_functions;
 		std::vector<uint32_t> repl_used_constants;
 		std::vector<value> temp_gc_exempt; //stores values exempt from garbage collection for 1 cycle
@@ -445,17 +746,167 @@ namespace HulaScript {
 		//executes instructions loaded in instructions
 		void execute();
 
-		//executes arbitrary_ins
-		void execute_arbitrary(const std::vector<instruction>& arbitrary_ins);
+		//calls anything but a closure; arguments may point into the evaluation stack, above call_value
+		value call_native(value call_value, std::span<const value> arguments);
+
+		//LOAD_TABLE and STORE_TABLE, less the inline cache, which is only used when cache isn't NULL
+		value load_table(value table_value, value key, inline_cache* cache);
+		void store_table(value table_value, value key, value set_value, bool store_inherited);
 
 		//allocates a zone in heap, represented by gc_block
 		gc_block allocate_block(size_t capacity, bool allow_collect);
+		std::optional<gc_block> take_free_block(size_t capacity);
+		void insert_free_block(gc_block block);
+		void clear_free_blocks();
 		size_t allocate_table(size_t capacity, bool allow_collect);
 
+		//the index into table's block that a key outside of the array part is stored at
+		std::optional<size_t> find_hash(const table& table, size_t hash) const noexcept {
+			if (table.layout != NULL) {
+				auto it = table.layout->key_hashes.find(hash);
+				if (it != table.layout->key_hashes.end()) {
+					return it->second;
+				}
+				return std::nullopt;
+			}
+
+			auto it = table.key_hashes.find(hash);
+			if (it != table.key_hashes.end()) {
+				return it->second;
+			}
+			return std::nullopt;
+		}
+
+		//the index into table's block that key is stored at; the array part is found by the key's value, without hashing
+		std::optional<size_t> find_key(const table& table, const value& key, size_t hash) const noexcept {
+			if (key.type == value::vtype::NUMBER && key.data.number >= 0 && key.data.number < table.array_count) {
+				size_t index = static_cast<size_t>(key.data.number);
+				if (value(static_cast<double>(index)).data.id == key.data.id) { //rules out fractions and -0
+					return index;
+				}
+			}
+			return find_hash(table, hash);
+		}
+
+		//the shape from adding one more property to from
+		shape* transition_shape(shape* from, size_t hash);
+
+		//maps key to index table.count, which the caller then fills in; the array part only grows while it is the whole table
+		void insert_key(table& table, const value& key, size_t hash) {
+			if (table.array_count == table.count && key.type == value::vtype::NUMBER && value(static_cast<double>(table.count)).data.id == key.data.id) {
+				table.array_count++;
+				return;
+			}
+
+			if (table.layout != NULL) {
+				if (key.type == value::vtype::INTERNAL_STRHASH && table.array_count == 0 && table.layout->key_hashes.size() == table.count && table.count < max_shape_properties) {
+					table.layout = transition_shape(table.layout, hash);
+					return;
+				}
+
+				table.key_hashes.insert(table.layout->key_hashes.begin(), table.layout->key_hashes.end());
+				table.layout = NULL;
+			}
+			table.key_hashes.insert({ hash, table.count });
+		}
+
 		//expands/retracts the size of a table
 		void reallocate_table(size_t table_id, size_t new_capacity, bool allow_collect);
 
-		void garbage_collect(bool compact_instructions) noexcept;
+		void collect_young() noexcept;
+
+		template<bool concurrent>
+		void mark_reference(value to_mark, std::vector<value>& gray, std::vector<uint32_t>& gray_function_ids);
+		template<bool concurrent>
+		void trace_function(uint32_t function_id, std::vector<value>& gray, std::vector<uint32_t>& gray_function_ids);
+
+		void mark_value(value to_mark);
+		void mark_gc_roots();
+		bool worth_marking_in_parallel() const noexcept;
+		void parallel_mark() noexcept;
+		void begin_major_collection() noexcept;
+		void sweep() noexcept;
+
+		//both return whether they finished before the deadline
+		bool mark_slice(std::optional<std::chrono::steady_clock::time_point> deadline) noexcept;
+		bool compact_slice(std::optional<std::chrono::steady_clock::time_point> deadline) noexcept;
+
+		//advances the collection in progress by up to gc_slice_budget
+		void gc_slice() noexcept;
+
+		//frees what the statement just run added and no longer needs, without touching the rest of the heap
+		void reclaim_statement() noexcept;
+
+		//moves the functions starting at or past from down over any gaps, and drops the instructions after the last one
+		void compact_instructions(size_t from) noexcept;
+
+		//a minor collection, or the start of a full one once the old generation has doubled
+		void collect_garbage() noexcept {
+			if (gc_phase != collection_phase::IDLE) {
+				return;
+			}
+
+			if (promoted_slots > live_slots || promoted_foreign_bytes > live_foreign_bytes) {
+				begin_major_collection();
+			}
+			else {
+				collect_young();
+			}
+		}
+
+		//only call where every live value is rooted
+		void gc_safe_point() noexcept {
+			if (gc_phase == collection_phase::IDLE) {
+				if (young_foreign_objs.size() >= nursery_size || foreign_bytes >= foreign_bytes_limit) {
+					collect_garbage();
+				}
+			}
+			else if (allocations_since_slice >= slice_allocations || foreign_bytes >= foreign_bytes_limit) {
+				allocations_since_slice = 0;
+				gc_slice();
+			}
+		}
+
+		void shade(value allocated) {
+			if (gc_phase == collection_phase::MARKING) {
+				mark_value(allocated);
+			}
+		}
+
+		//strings are prefixed by their mark byte
+		char* allocate_string(size_t length) {
+			auto res = active_strs.insert(std::unique_ptr<char[]>(new char[length + 2]));
+			res.first->get()[0] = false;
+			return res.first->get() + 1;
+		}
+
+		void free_block(gc_block block) {
+			if (block.capacity > 0 && gc_phase != collection_phase::COMPACTING) {
+				insert_free_block(block);
+			}
+		}
+
+		//old tables given a value that may reference something young are rescanned by the next minor collection,
+		//and while marking, the stored value is shaded in case the table has already been traced
+		void write_barrier(table& table, size_t table_id, const value& stored) {
+			switch (stored.type) {
+			case value::vtype::TABLE:
+			case value::vtype::CLOSURE:
+			case value::vtype::FOREIGN_OBJECT:
+			case value::vtype::FOREIGN_OBJECT_METHOD:
+				if (table.tenured && !table.remembered) {
+					table.remembered = true;
+					remembered_tables.push_back(table_id);
+				}
+				[[fallthrough]];
+			case value::vtype::STRING:
+			case value::vtype::FOREIGN_FUNCTION:
+				shade(stored);
+				break;
+			default:
+				break;
+			}
+		}
 		void finalize();
 
 		void expect_type(value::vtype expected_type) const {
@@ -484,12 +935,14 @@ namespace HulaScript {
 				}
 
 				constants.push_back(constant);
+				young_constants.push_back(static_cast<uint32_t>(constants.size() - 1));
 				return static_cast<uint32_t>(constants.size() - 1);
 			}
 			else {
 				uint32_t index = availible_constant_ids.back();
 				availible_constant_ids.pop_back();
 				constants[index] = constant;
+				young_constants.push_back(index);
 				return index;
 			}
 		}
@@ -661,6 +1114,7 @@ namespace HulaScript {
 		std::vector<size_t> top_level_local_vars;
 		std::vector<size_t> global_vars;
 		custom_numerical_parser numerical_parser;
+		custom_rational_spiller rational_spiller;
 
 		void emit_load_variable(std::string name, compilation_context& context);
 
@@ -695,5 +1149,8 @@ namespace HulaScript {
 		void compile_class(compilation_context& context);
 
 		void compile(compilation_context& context, bool repl_mode=false);
+
+		//fuses common sequences in a finished block of instructions into superinstructions
+		static void peephole_optimize(std::vector<instruction>& instructions) noexcept;
 	};
 }
\ No newline at end of file
@@ -6,42 +6,67 @@
 #include "phmap.h"
 
 namespace HulaScript {
+	//Methods are declared once per child_type, by a static child_type::declare_methods() that runs the first time any
+	//instance looks one up, and the resulting table is shared by every instance. Constructing an object costs nothing extra.
 	template<typename child_type>
 	class foreign_method_object : public instance::foreign_object {
 	public:
 		instance::value load_property(size_t name_hash, instance& instance) override {
-			auto it = method_id_lookup.find(name_hash);
-			if (it != method_id_lookup.end()) {
+			const method_table& table = shared_methods();
+			auto it = table.method_id_lookup.find(name_hash);
+			if (it != table.method_id_lookup.end()) {
 				return instance::value(it->second, static_cast<foreign_object*>(this));
 			}
 			return instance::value();
 		}
 
-		instance::value call_method(uint32_t method_id, std::vector<instance::value>& arguments, instance& instance) override {
-			if (method_id >= methods.size()) {
+		instance::value call_method(uint32_t method_id, std::span<const instance::value> arguments, instance& instance) override {
+			const method_table& table = shared_methods();
+			if (method_id >= table.methods.size()) {
 				return instance::value();
 			}
-			return (dynamic_cast<child_type*>(this)->*methods[method_id])(arguments, instance);
+			return (static_cast<child_type*>(this)->*table.methods[method_id])(arguments, instance);
+		}
+
+		//a child_type that overrides load_property must override this too
+		bool has_shared_properties() override {
+			return true;
 		}
 	protected:
-		bool declare_method(std::string name, instance::value(child_type::* method)(std::vector<instance::value>& arguments, instance& instance)) {
+		//only call from child_type::declare_methods()
+		static bool declare_method(std::string name, instance::value(child_type::* method)(std::span<const instance::value> arguments, instance& instance)) {
+			method_table& table = declared_methods();
+
 			size_t name_hash = Hash::dj2b(name.c_str());
-			if (method_id_lookup.contains(name_hash)) {
+			if (table.method_id_lookup.contains(name_hash)) {
 				return false;
 			}
 			
-			method_id_lookup.insert(std::make_pair(name_hash, methods.size()));
-			methods.push_back(method);
+			table.method_id_lookup.insert(std::make_pair(name_hash, table.methods.size()));
+			table.methods.push_back(method);
 			return true;
 		}
 	private:
-		phmap::flat_hash_map<size_t, uint32_t> method_id_lookup;
-		std::vector<instance::value(child_type::*)(std::vector<instance::value>& arguments, instance& instance)> methods;
+		struct method_table {
+			phmap::flat_hash_map<size_t, uint32_t> method_id_lookup;
+			std::vector<instance::value(child_type::*)(std::span<const instance::value> arguments, instance& instance)> methods;
+		};
+
+		static method_table& declared_methods() {
+			static method_table table;
+			return table;
+		}
+
+		static const method_table& shared_methods() {
+			//initialization of a function local static is thread safe, so declare_methods runs exactly once
+			[[maybe_unused]] static const bool declared = (child_type::declare_methods(), true);
+			return declared_methods();
+		}
 	};
 
 	class foreign_iterator : public foreign_method_object<foreign_iterator> {
 	public:
-		foreign_iterator() {
+		static void declare_methods() {
 			declare_method("next", &foreign_iterator::ffi_next);
 			declare_method("hasNext", &foreign_iterator::ffi_has_next);
 		}
@@ -51,11 +76,11 @@ namespace HulaScript {
 		virtual instance::value next(instance& instance) = 0;
 
 	private:
-		instance::value ffi_has_next(std::vector<instance::value>& arguments, instance& instance) {
+		instance::value ffi_has_next(std::span<const instance::value> arguments, instance& instance) {
 			return instance::value(has_next(instance));
 		}
 
-		instance::value ffi_next(std::vector<instance::value>& arguments, instance& instance) {
+		instance::value ffi_next(std::span<const instance::value> arguments, instance& instance) {
 			return next(instance);
 		}
 	};
@@ -787,6 +787,7 @@ uint32_t instance::emit_finalize_function(compilation_context& context) {
 	}
 
 	size_t offset = instructions.size();
+	peephole_optimize(scope.instructions);
 	instructions.insert(instructions.end(), scope.instructions.begin(), scope.instructions.end());
 	for (auto src_loc : scope.ip_src_map) {
 		this->ip_src_map.insert(std::make_pair(src_loc.first + offset, src_loc.second));
@@ -808,6 +809,7 @@ uint32_t instance::emit_finalize_function(compilation_context& context) {
 		availible_function_ids.pop_back();
 	}
 	functions.insert({ id, function });
+	young_functions.push_back(id);
 
 	if (!context.function_decls.empty()) {
 		context.function_decls.back().refed_functions.insert(id);
@@ -1009,6 +1011,7 @@ void instance::compile_class(compilation_context& context) {
 }
 
 void instance::compile(compilation_context& context, bool repl_mode) {
+	statement_start = instructions.size();
 	context.lexical_scopes.push_back({ .next_local_id = top_level_local_vars.size(), .declared_locals = top_level_local_vars, .all_code_paths_return = false, .is_loop_block = false});
 	
 	operand local_offset = 0;
@@ -1083,7 +1086,9 @@ void instance::compile(compilation_context& context, bool repl_mode) {
 	global_vars.insert(global_vars.end(), context.declared_globals.begin(), context.declared_globals.end());
 
 	ip = instructions.size();
+	peephole_optimize(context.lexical_scopes.back().instructions);
 	instructions.insert(instructions.end(), context.lexical_scopes.back().instructions.begin(), context.lexical_scopes.back().instructions.end());
+	instructions.push_back({ .operation = opcode::HALT });
 	for (auto src_loc : context.lexical_scopes.back().ip_src_map) {
 		this->ip_src_map.insert(std::make_pair(src_loc.first + ip, src_loc.second));
 	}
@@ -29,7 +29,9 @@ private:
 
 class int_range : public foreign_method_object<int_range> {
 public:
-	int_range(int64_t start, int64_t stop, int64_t step) : start(start), stop(stop), step(step) {
+	int_range(int64_t start, int64_t stop, int64_t step) : start(start), stop(stop), step(step) { }
+
+	static void declare_methods() {
 		declare_method("iterator", &int_range::get_iterator);
 	}
 
@@ -38,7 +40,7 @@ private:
 	int64_t step;
 	int64_t stop;
 
-	instance::value get_iterator(std::vector<instance::value>& arguments, instance& instance) {
+	instance::value get_iterator(std::span<const instance::value> arguments, instance& instance) {
 		return instance.add_foreign_object(std::make_unique<int_range_iterator>(int_range_iterator(start, stop, step)));
 	}
 };
@@ -48,16 +50,18 @@ private:
 	std::mt19937 rng;
 	std::uniform_real_distribution<double> unif_real;
 
-	instance::value next_real(std::vector<instance::value>& arguments, instance& instance) {
+	instance::value next_real(std::span<const instance::value> arguments, instance& instance) {
 		return instance::value(unif_real(rng));
 	}
 public:
-	random_generator(double lower_bound, double upper_bound) : unif_real(lower_bound, upper_bound) {
+	random_generator(double lower_bound, double upper_bound) : unif_real(lower_bound, upper_bound) { }
+
+	static void declare_methods() {
 		declare_method("next", &random_generator::next_real);
 	}
 };
 
-static instance::value new_int_range(std::vector<instance::value> arguments, instance& instance) {
+static instance::value new_int_range(std::span<const instance::value> arguments, instance& instance) {
 	int64_t start = 0;
 	int64_t step = 1;
 	int64_t stop;
@@ -92,7 +96,7 @@ static instance::value new_int_range(std::vector<instance::value> arguments, ins
 	return instance.add_foreign_object(std::make_unique<int_range>(int_range(start, stop, step)));
 }
 
-static instance::value new_random_generator(std::vector<instance::value> arguments, instance& instance) {
+static instance::value new_random_generator(std::span<const instance::value> arguments, instance& instance) {
 	if (arguments.size() != 2) {
 		instance.panic("FFI Error: A random generator instance needs a lower bound and an upper bound, two arguments.");
 	}
@@ -107,16 +111,17 @@ static instance::value new_random_generator(std::vector<instance::value> argumen
 	return instance.add_foreign_object(std::make_unique<random_generator>(random_generator(lower_bound, upper_bound)));
 }
 
-static instance::value sort_table(std::vector<instance::value> arguments, instance& instance) {
+static instance::value sort_table(std::span<const instance::value> arguments, instance& instance) {
 	if (arguments.size() != 2) {
 		instance.panic("FFI Error: Function sort expects 2 arguments: a array-table, and a comparator (return whether left is less than right).");
 	}
 
 	HulaScript::ffi_table_helper helper(arguments[0], instance);
+	instance::value comparator = arguments[1]; //calling back into the instance invalidates arguments
 	for (size_t i = 0; i < helper.size() - 1; i++) {
 		bool swapped = false;
 		for (size_t j = 0; j < helper.size() - i - 1; j++) {
-			bool cmp = instance.invoke_value(arguments[1], {
+			bool cmp = instance.invoke_value(comparator, {
 				helper.at_index(j), helper.at_index(j + 1)
 			}).boolean(instance);
 
@@ -134,12 +139,14 @@ static instance::value sort_table(std::vector<instance::value> arguments, instan
 	return instance::value();
 }
 
-static instance::value binary_search_table(std::vector<instance::value> arguments, instance& instance) {
+static instance::value binary_search_table(std::span<const instance::value> arguments, instance& instance) {
 	if (arguments.size() != 3) {
 		instance.panic("FFI Error: Function sort expects 2 arguments: a array-table, and a comparator (return whether left is less than right), and a key.");
 	}
 
 	HulaScript::ffi_table_helper helper(arguments[0], instance);
+	instance::value comparator = arguments[1]; //calling back into the instance invalidates arguments
+	instance::value key = arguments[2];
 	size_t low = 0;
 	size_t high = helper.size();
 	size_t mid = low;
@@ -147,12 +154,12 @@ static instance::value binary_search_table(std::vector<instance::value> argument
 	while (low <= high) {
 		mid = low + (high - low) / 2;
 
-		bool cmp_res = instance.invoke_value(arguments[1], { helper.at_index(mid), arguments[2] }).boolean(instance);
+		bool cmp_res = instance.invoke_value(comparator, { helper.at_index(mid), key }).boolean(instance);
 		if (cmp_res) {
 			low = mid + 1;
 		}
 		else {
-			bool cmp_res2 = instance.invoke_value(arguments[1], { arguments[2], helper.at_index(mid) }).boolean(instance);
+			bool cmp_res2 = instance.invoke_value(comparator, { key, helper.at_index(mid) }).boolean(instance);
 			if (cmp_res) {
 				high = mid - 1;
 			}
@@ -165,7 +172,7 @@ static instance::value binary_search_table(std::vector<instance::value> argument
 	return instance::value(-(static_cast<double>(mid) + 1));
 }
 
-static instance::value iterator_to_array(std::vector<instance::value> arguments, instance& instance) {
+static instance::value iterator_to_array(std::span<const instance::value> arguments, instance& instance) {
 	if (arguments.size() != 1) {
 		instance.panic("FFI Error: Iterator-to-array expects one argument, an iterator object, but did not receive it.");
 	}
@@ -233,7 +240,7 @@ static instance::value standard_number_parser(std::string str, instance& instanc
 	return instance::value(std::stod(str));
 }
 
-instance::instance(custom_numerical_parser numerical_parser) : numerical_parser(numerical_parser) {
+instance::instance(custom_numerical_parser numerical_parser, custom_rational_spiller rational_spiller) : numerical_parser(numerical_parser), rational_spiller(rational_spiller) {
 	declare_global("irange", make_foreign_function(new_int_range));
 	declare_global("random", make_foreign_function(new_random_generator));
 
@@ -1,150 +1,571 @@
 #include <algorithm>
+#include <bit>
+#include <chrono>
 #include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <system_error>
 #include "HulaScript.h"
 
 using namespace HulaScript;
 
+static size_t size_class(size_t capacity) {
+	return std::bit_width(capacity) - 1;
+}
+
 instance::gc_block instance::allocate_block(size_t capacity, bool allow_collect) {
-	auto it = free_blocks.lower_bound(capacity);
-	if (it != free_blocks.end()) {
-		gc_block block = it->second;
-		it = free_blocks.erase(it);
-		return block;
+	if (capacity == 0) {
+		return gc_block(heap.size(), 0);
+	}
+
+	auto block = take_free_block(capacity);
+	if (block.has_value()) {
+		return block.value();
 	}
 
 	if (heap.size() + capacity >= heap.capacity() && allow_collect) {
-		garbage_collect(false);
+		collect_garbage();
+
+		block = take_free_block(capacity);
+		if (block.has_value()) {
+			return block.value();
+		}
 	}
 
-	gc_block block(heap.size(), capacity);
+	gc_block appended(heap.size(), capacity);
 	heap.insert(heap.end(), capacity, value());
-	return block;
+	return appended;
+}
+
+std::optional<instance::gc_block> instance::take_free_block(size_t capacity) {
+	//every block in the class of the next power of two up fits
+	for (size_t k = std::bit_width(capacity - 1); k < size_classes; k++) {
+		auto& free_list = free_lists[k];
+		while (!free_list.empty()) {
+			size_t start = free_list.back();
+			free_list.pop_back();
+			free_list_entries--;
+
+			auto it = free_block_starts.find(start);
+			if (it == free_block_starts.end() || size_class(it->second) != k) {
+				continue; //stale
+			}
+
+			size_t block_capacity = it->second;
+			free_block_starts.erase(it);
+			free_block_ends.erase(start + block_capacity);
+			if (block_capacity > capacity) {
+				insert_free_block(gc_block(start + capacity, block_capacity - capacity));
+			}
+			return gc_block(start, capacity);
+		}
+	}
+	return std::nullopt;
+}
+
+void instance::insert_free_block(gc_block block) {
+	auto left = free_block_ends.find(block.start);
+	if (left != free_block_ends.end()) {
+		size_t left_start = left->second;
+		free_block_ends.erase(left);
+		block.capacity += block.start - left_start;
+		block.start = left_start;
+		free_block_starts.erase(left_start);
+	}
+
+	auto right = free_block_starts.find(block.start + block.capacity);
+	if (right != free_block_starts.end()) {
+		size_t right_capacity = right->second;
+		free_block_starts.erase(right);
+		free_block_ends.erase(block.start + block.capacity + right_capacity);
+		block.capacity += right_capacity;
+	}
+
+	if (block.start + block.capacity == heap.size()) {
+		heap.erase(heap.begin() + block.start, heap.end());
+		return;
+	}
+
+	free_block_starts.insert({ block.start, block.capacity });
+	free_block_ends.insert({ block.start + block.capacity, block.start });
+	free_lists[size_class(block.capacity)].push_back(block.start);
+	free_list_entries++;
+
+	//drop stale entries once they outnumber the live ones
+	if (free_list_entries > 2 * free_block_starts.size() + 64) {
+		for (auto& free_list : free_lists) {
+			free_list.clear();
+		}
+		for (auto [start, capacity] : free_block_starts) {
+			free_lists[size_class(capacity)].push_back(start);
+		}
+		free_list_entries = free_block_starts.size();
+	}
+}
+
+void instance::clear_free_blocks() {
+	for (auto& free_list : free_lists) {
+		free_list.clear();
+	}
+	free_list_entries = 0;
+	free_block_starts.clear();
+	free_block_ends.clear();
 }
 
 size_t instance::allocate_table(size_t capacity, bool allow_collect) {
-	table t(allocate_block(capacity, allow_collect));
+	table t(allocate_block(capacity, allow_collect), empty_shape);
 
-	tables.insert({ next_table_id, t });
-	next_table_id++;
-	return next_table_id - 1;
+	//ids are reused so the mark bitmap stays as small as the table count
+	size_t id;
+	if (availible_table_ids.empty()) {
+		id = next_table_id;
+		next_table_id++;
+	}
+	else {
+		id = availible_table_ids.back();
+		availible_table_ids.pop_back();
+	}
+
+	tables.insert({ id, t });
+	young_tables.push_back(id);
+	shade(value(value::vtype::TABLE, value::flags::NONE, 0, id));
+	allocations_since_slice++;
+	return id;
+}
+
+instance::shape* instance::transition_shape(shape* from, size_t hash) {
+	auto it = from->transitions.find(hash);
+	if (it != from->transitions.end()) {
+		return it->second;
+	}
+
+	shape* to = shapes.emplace_back(std::make_unique<shape>()).get();
+	to->key_hashes = from->key_hashes;
+	to->key_hashes.insert({ hash, from->key_hashes.size() });
+	from->transitions.insert({ hash, to });
+	return to;
 }
 
 void instance::reallocate_table(size_t table_id, size_t new_capacity, bool allow_collect) {
 	table& t = tables.at(table_id);
 
 	if (new_capacity > t.block.capacity) {
+		//an old table growing grows the old generation as much as promoting a young one would
+		if (t.tenured) {
+			promoted_slots += new_capacity - t.block.capacity;
+		}
+
+		//grow in place into a free block to the right, or onto the end of the heap while it has room
+		size_t end = t.block.start + t.block.capacity;
+		auto right = free_block_starts.find(end);
+		if (right != free_block_starts.end() && t.block.capacity + right->second >= new_capacity) {
+			size_t right_capacity = right->second;
+			free_block_starts.erase(right);
+			free_block_ends.erase(end + right_capacity);
+
+			size_t needed = new_capacity - t.block.capacity;
+			t.block.capacity = new_capacity;
+			if (right_capacity > needed) {
+				insert_free_block(gc_block(end + needed, right_capacity - needed));
+			}
+			return;
+		}
+		if (end == heap.size() && gc_phase != collection_phase::COMPACTING && heap.size() + (new_capacity - t.block.capacity) < heap.capacity()) {
+			heap.insert(heap.end(), new_capacity - t.block.capacity, value());
+			t.block.capacity = new_capacity;
+			return;
+		}
+
 		gc_block block = allocate_block(new_capacity, allow_collect);
 		auto start_it = heap.begin() + t.block.start;
 		std::move(start_it, start_it + t.count, heap.begin() + block.start);
 
-		if (block.capacity > 0) {
-			free_blocks.insert({ t.block.capacity, t.block });
-		}
+		free_block(t.block);
 		t.block = block;
 	}
 	else if (new_capacity < t.block.capacity) {
 		gc_block block = gc_block(t.block.start + new_capacity, t.block.capacity - new_capacity);
 		t.block.capacity = new_capacity;
-		free_blocks.insert({ block.capacity, block });
+		free_block(block);
 	}
 }
 
-void instance::garbage_collect(bool compact_instructions) noexcept {
+void instance::collect_young() noexcept {
 	std::vector<value> values_to_trace;
-	std::vector<uint32_t> functions_to_trace;
 
 	values_to_trace.insert(values_to_trace.end(), evaluation_stack.begin(), evaluation_stack.end());
 	values_to_trace.insert(values_to_trace.end(), globals.begin(), globals.end());
 	values_to_trace.insert(values_to_trace.end(), locals.begin(), locals.end());
 	values_to_trace.insert(values_to_trace.end(), temp_gc_exempt.begin(), temp_gc_exempt.end());
+	for (auto& constant : constants) {
+		if (!(constant.flags & value::flags::INVALID_CONSTANT)) {
+			values_to_trace.push_back(constant);
+		}
+	}
+	for (auto table_id : remembered_tables) {
+		table& table = tables.at(table_id);
+		values_to_trace.insert(values_to_trace.end(), heap.begin() + table.block.start, heap.begin() + table.block.start + table.count);
+		table.remembered = false;
+	}
+	remembered_tables.clear();
+
+	//reaching a young object promotes it, so the tenured flag doubles as the mark bit and old objects are never traced through
+	while (!values_to_trace.empty()) {
+		value to_trace = values_to_trace.back();
+		values_to_trace.pop_back();
+
+		switch (to_trace.type)
+		{
+		case value::vtype::CLOSURE:
+			functions.at(to_trace.function_id).tenured = true;
+			if (!(to_trace.flags & value::flags::HAS_CAPTURE_TABLE)) {
+				break;
+			}
+			[[fallthrough]];
+		case value::vtype::TABLE: {
+			table& table = tables.at(to_trace.data.id);
+			if (!table.tenured) {
+				table.tenured = true;
+				promoted_slots += table.block.capacity;
+				values_to_trace.insert(values_to_trace.end(), heap.begin() + table.block.start, heap.begin() + table.block.start + table.count);
+			}
+			break;
+		}
+		case value::vtype::FOREIGN_OBJECT_METHOD:
+			[[fallthrough]];
+		case value::vtype::FOREIGN_OBJECT:
+			if (!to_trace.data.foreign_object->tenured) {
+				to_trace.data.foreign_object->tenured = true;
+				promoted_foreign_bytes += to_trace.data.foreign_object->footprint;
+				to_trace.data.foreign_object->trace(values_to_trace);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	for (auto table_id : young_tables) {
+		auto it = tables.find(table_id);
+		if (it->second.tenured) {
+			continue;
+		}
+
+		free_block(it->second.block);
+		availible_table_ids.push_back(table_id);
+		tables.erase(it);
+	}
+	young_tables.clear();
+
+	for (auto foreign_obj : young_foreign_objs) {
+		if (!foreign_obj->tenured) {
+			foreign_bytes -= foreign_obj->footprint;
+			foreign_objs.erase(foreign_objs.find(foreign_obj));
+		}
+	}
+	young_foreign_objs.clear();
+	foreign_bytes_limit = foreign_bytes + gc_heap_budget;
+}
+
+template<bool concurrent>
+void instance::mark_reference(value to_mark, std::vector<value>& gray, std::vector<uint32_t>& gray_function_ids) {
+	switch (to_mark.type)
+	{
+	case value::vtype::CLOSURE:
+		if (marked_functions.mark<concurrent>(to_mark.function_id)) {
+			gray_function_ids.push_back(to_mark.function_id);
+		}
+		if (!(to_mark.flags & value::flags::HAS_CAPTURE_TABLE)) {
+			break;
+		}
+		[[fallthrough]];
+	case value::vtype::TABLE:
+		if (marked_tables.mark<concurrent>(to_mark.data.id)) {
+			gray.push_back(value(value::vtype::TABLE, value::flags::NONE, 0, to_mark.data.id));
+		}
+		break;
+	case value::vtype::STRING:
+		if constexpr (concurrent) {
+			std::atomic_ref<char>(to_mark.data.str[-1]).store(true, std::memory_order_relaxed);
+		}
+		else {
+			to_mark.data.str[-1] = true;
+		}
+		break;
+	case value::vtype::FOREIGN_OBJECT_METHOD:
+		[[fallthrough]];
+	case value::vtype::FOREIGN_OBJECT: {
+		bool was_marked;
+		if constexpr (concurrent) {
+			was_marked = std::atomic_ref<bool>(to_mark.data.foreign_object->marked).exchange(true, std::memory_order_relaxed);
+		}
+		else {
+			was_marked = to_mark.data.foreign_object->marked;
+			to_mark.data.foreign_object->marked = true;
+		}
+		if (!was_marked) {
+			gray.push_back(to_mark);
+		}
+		break;
+	}
+	case value::vtype::FOREIGN_FUNCTION:
+		marked_foreign_functions.mark<concurrent>(to_mark.function_id);
+		break;
+	default:
+		break;
+	}
+}
+
+template<bool concurrent>
+void instance::trace_function(uint32_t function_id, std::vector<value>& gray, std::vector<uint32_t>& gray_function_ids) {
+	function_entry& function = functions.at(function_id);
+	for (uint32_t id : function.referenced_functions) {
+		if (marked_functions.mark<concurrent>(id)) {
+			gray_function_ids.push_back(id);
+		}
+	}
+	for (uint32_t id : function.referenced_constants) {
+		if (marked_constants.mark<concurrent>(id)) {
+			mark_reference<concurrent>(constants[id], gray, gray_function_ids);
+		}
+	}
+}
+
+void instance::mark_value(value to_mark) {
+	mark_reference<false>(to_mark, gray_values, gray_functions);
+}
+
+void instance::mark_gc_roots() {
+	for (auto& root : evaluation_stack) {
+		mark_value(root);
+	}
+	for (auto& root : globals) {
+		mark_value(root);
+	}
+	for (auto& root : locals) {
+		mark_value(root);
+	}
+	for (auto& root : temp_gc_exempt) {
+		mark_value(root);
+	}
 	for (auto id : repl_used_constants) {
-		values_to_trace.push_back(constants[id]);
+		if (marked_constants.mark(id)) {
+			mark_value(constants[id]);
+		}
 	}
+	for (auto id : repl_used_functions) {
+		if (marked_functions.mark(id)) {
+			gray_functions.push_back(id);
+		}
+	}
+}
 
-	//temp_gc_exempt.clear();
+void instance::begin_major_collection() noexcept {
+	marked_tables.clear();
+	marked_functions.clear();
+	marked_constants.clear();
+	marked_foreign_functions.clear();
 
-	phmap::flat_hash_set<size_t> marked_tables;
-	phmap::flat_hash_set<uint32_t> marked_functions;
-	phmap::flat_hash_set<char*> marked_strs;
-	phmap::flat_hash_set<uint32_t> marked_constants;
-	phmap::flat_hash_set<foreign_object*> marked_foreign_objects;
-	phmap::flat_hash_set<uint32_t> marked_foreign_functions;
+	gc_phase = collection_phase::MARKING;
+	mark_gc_roots();
+}
 
-	functions_to_trace.insert(functions_to_trace.end(), repl_used_functions.begin(), repl_used_functions.end());
+bool instance::worth_marking_in_parallel() const noexcept {
+	//sized by what's left gray rather than the whole heap, most of which may be marked already
+	size_t gray_slots = 0;
+	for (auto& gray : gray_values) {
+		gray_slots += gray.type == value::vtype::TABLE ? tables.at(gray.data.id).count : 1;
+		if (gray_slots >= parallel_mark_threshold) {
+			return true;
+		}
+	}
+	return false;
+}
 
-	while (!values_to_trace.empty() || !functions_to_trace.empty()) //trace values 
+bool instance::mark_slice(std::optional<std::chrono::steady_clock::time_point> deadline) noexcept {
+	//the gray set is sized again as tracing reveals more of the heap, no more often than it takes to trace what's gray
+	bool may_go_parallel = !deadline.has_value() && gc_mark_threads > 1;
+	size_t next_sizing = 0;
+
+	size_t traced = 0;
+	while (!gray_values.empty() || !gray_functions.empty()) //trace values 
 	{
-		if (!values_to_trace.empty()) {
-			value to_trace = values_to_trace.back();
-			values_to_trace.pop_back();
+		traced++;
+		if (deadline.has_value() && traced % 256 == 0 && std::chrono::steady_clock::now() >= deadline.value()) {
+			return false;
+		}
+		if (may_go_parallel && traced >= next_sizing) {
+			if (worth_marking_in_parallel()) {
+				parallel_mark();
+				return true;
+			}
+			next_sizing = traced + std::max<size_t>(4096, gray_values.size());
+		}
 
-			switch (to_trace.type)
-			{
-			case value::vtype::CLOSURE:
-				functions_to_trace.push_back(to_trace.function_id);
-				if (!(to_trace.flags & value::flags::HAS_CAPTURE_TABLE)) {
-					break;
-				}
-				[[fallthrough]];
-			case value::vtype::TABLE: {
+		if (!gray_values.empty()) {
+			value to_trace = gray_values.back();
+			gray_values.pop_back();
+
+			if (to_trace.type == value::vtype::TABLE) {
 				table& table = tables.at(to_trace.data.id);
-				if (!marked_tables.contains(to_trace.data.id)) {
-					marked_tables.insert(to_trace.data.id);
-					for (size_t i = 0; i < table.count; i++) {
-						values_to_trace.push_back(heap[i + table.block.start]);
-					}
+				for (size_t i = 0; i < table.count; i++) {
+					mark_value(heap[table.block.start + i]);
 				}
-				break;
-			}
-			case value::vtype::STRING:
-				marked_strs.insert(to_trace.data.str);
-				break;
-			case value::vtype::FOREIGN_OBJECT_METHOD:
-				[[fallthrough]];
-			case value::vtype::FOREIGN_OBJECT: {
-				marked_foreign_objects.insert(to_trace.data.foreign_object);
-				to_trace.data.foreign_object->trace(values_to_trace);
-				break;
-			case value::vtype::FOREIGN_FUNCTION: {
-				marked_foreign_functions.insert(to_trace.function_id);
-				break;
-			}
 			}
+			else {
+				to_trace.data.foreign_object->trace(traced_values);
+				for (auto& traced : traced_values) {
+					mark_value(traced);
+				}
+				traced_values.clear();
 			}
 		}
 
-		while (!functions_to_trace.empty()) //trace functions
+		while (!gray_functions.empty()) //trace functions
 		{
-			uint32_t function_id = functions_to_trace.back();
-			functions_to_trace.pop_back();
+			uint32_t function_id = gray_functions.back();
+			gray_functions.pop_back();
+			trace_function<false>(function_id, gray_values, gray_functions);
+		}
+	}
+	return true;
+}
+
+void instance::parallel_mark() noexcept {
+	//functions are few, and are traced up front so every gray function id left is a worker's own
+	while (!gray_functions.empty()) {
+		uint32_t function_id = gray_functions.back();
+		gray_functions.pop_back();
+		trace_function<false>(function_id, gray_values, gray_functions);
+	}
+
+	marked_tables.cover(next_table_id);
+	marked_functions.cover(next_function_id);
+	marked_constants.cover(constants.size());
+	marked_foreign_functions.cover(foreign_functions.size());
+
+	struct mark_queue {
+		std::mutex lock;
+		std::deque<value> values;
+	};
+
+	size_t thread_count = std::max<size_t>(1, std::min(gc_mark_threads, gray_values.size()));
+	std::vector<mark_queue> queues(thread_count);
+	for (size_t i = 0; i < gray_values.size(); i++) {
+		queues[i % thread_count].values.push_back(gray_values[i]);
+	}
+	std::atomic<size_t> pending(gray_values.size()); //queued or being traced
+	gray_values.clear();
+	parallel_marks++;
+
+	auto worker = [this, &queues, &pending](size_t slot) {
+		std::vector<value> found;
+		std::vector<uint32_t> found_functions;
+		std::vector<value> traced;
+
+		while (true) {
+			std::optional<value> taken;
+			{
+				std::lock_guard<std::mutex> guard(queues[slot].lock);
+				if (!queues[slot].values.empty()) {
+					taken = queues[slot].values.back();
+					queues[slot].values.pop_back();
+				}
+			}
+			for (size_t i = 1; !taken.has_value() && i < queues.size(); i++) {
+				mark_queue& victim = queues[(slot + i) % queues.size()];
+				std::lock_guard<std::mutex> guard(victim.lock);
+				if (!victim.values.empty()) {
+					taken = victim.values.front();
+					victim.values.pop_front();
+				}
+			}
+			if (!taken.has_value()) {
+				if (pending.load(std::memory_order_acquire) == 0) {
+					return;
+				}
+				std::this_thread::yield();
+				continue;
+			}
+
+			value to_trace = taken.value();
+			if (to_trace.type == value::vtype::TABLE) {
+				//a table's first chunk queues the rest, which carry their index in function_id
+				table& table = tables.at(to_trace.data.id);
+				size_t chunk = to_trace.function_id;
+				if (chunk == 0) {
+					for (size_t i = 1; i * mark_chunk_slots < table.count; i++) {
+						found.push_back(value(value::vtype::TABLE, value::flags::NONE, static_cast<uint32_t>(i), to_trace.data.id));
+					}
+				}
 
-			auto res = marked_functions.emplace(function_id);
-			if (res.second) {
-				function_entry& function = functions.at(function_id);
+				size_t end = std::min(table.count, (chunk + 1) * mark_chunk_slots);
+				for (size_t i = chunk * mark_chunk_slots; i < end; i++) {
+					mark_reference<true>(heap[table.block.start + i], found, found_functions);
+				}
+			}
+			else {
+				to_trace.data.foreign_object->trace(traced);
+				for (auto& traced_value : traced) {
+					mark_reference<true>(traced_value, found, found_functions);
+				}
+				traced.clear();
+			}
+
+			while (!found_functions.empty()) {
+				uint32_t function_id = found_functions.back();
+				found_functions.pop_back();
+				trace_function<true>(function_id, found, found_functions);
+			}
 
-				functions_to_trace.insert(functions_to_trace.end(), function.referenced_functions.begin(), function.referenced_functions.end());
-				marked_constants.insert(function.referenced_constants.begin(), function.referenced_constants.end());
-				for (uint32_t id : function.referenced_constants) {
-					values_to_trace.push_back(constants[id]);
+			//count the new work before retiring this item, so pending can't reach zero early
+			if (!found.empty()) {
+				pending.fetch_add(found.size(), std::memory_order_relaxed);
+				{
+					std::lock_guard<std::mutex> guard(queues[slot].lock);
+					queues[slot].values.insert(queues[slot].values.end(), found.begin(), found.end());
 				}
+				found.clear();
 			}
+			pending.fetch_sub(1, std::memory_order_release);
 		}
+	};
+
+	//marking still finishes, on fewer threads, if some can't be started
+	std::vector<std::thread> helpers;
+	for (size_t slot = 1; slot < thread_count; slot++) {
+		try {
+			helpers.emplace_back(worker, slot);
+		}
+		catch (const std::system_error&) {
+			break;
+		}
+	}
+	worker(0);
+	for (auto& helper : helpers) {
+		helper.join();
 	}
+}
 
-	//remove unused table entries
+void instance::sweep() noexcept {
+	//remove unused table entries; everything left is old from here on
 	for (auto it = tables.begin(); it != tables.end(); ) {
-		if (!marked_tables.contains(it->first)) {
+		if (!marked_tables.is_marked(it->first)) {
 			availible_table_ids.push_back(it->first);
 			it = tables.erase(it);
 		}
 		else {
+			it->second.tenured = true;
+			it->second.remembered = false;
 			it++;
 		}
 	}
+	young_tables.clear();
+	remembered_tables.clear();
 
 	//remove unused constants
 	for (uint_fast32_t i = 0; i < constants.size(); i++) {
-		if (!marked_constants.contains(i)) {
+		if (!marked_constants.is_marked(i)) {
 			if (constants[i].flags & value::flags::INVALID_CONSTANT) {
 				continue;
 			}
@@ -159,107 +580,262 @@ void instance::garbage_collect(bool compact_instructions) noexcept {
 
 	//removed unused strings
 	for (auto it = active_strs.begin(); it != active_strs.end();) {
-		if (!marked_strs.contains(it->get())) {
+		if (!it->get()[0]) {
 			it = active_strs.erase(it);
 		}
 		else {
+			it->get()[0] = false;
 			it++;
 		}
 	}
 
 	for (auto it = foreign_objs.begin(); it != foreign_objs.end();) {
-		if (!marked_foreign_objects.contains(it->get())) {
+		if (!(*it)->marked) {
+			foreign_bytes -= (*it)->footprint;
 			it = foreign_objs.erase(it);
 		}
 		else {
+			(*it)->marked = false;
+			(*it)->tenured = true;
 			it++;
 		}
 	}
+	//an object's footprint can change after it's added, as a matrix's does when it's written to, or when what it shares
+	//memory with is freed; so survivors are only re-read once every dead object is gone
+	for (auto& foreign_obj : foreign_objs) {
+		size_t footprint = foreign_obj->memory_footprint();
+		foreign_bytes = foreign_bytes - foreign_obj->footprint + footprint;
+		foreign_obj->footprint = footprint;
+	}
+	full_collections++;
+	young_foreign_objs.clear();
+	live_foreign_bytes = foreign_bytes;
+	promoted_foreign_bytes = 0;
+	foreign_bytes_limit = foreign_bytes + gc_heap_budget;
+
+	for (uint_fast32_t i = 0; i < foreign_functions.size(); i++) {
+		if (foreign_functions[i] != NULL && !marked_foreign_functions.is_marked(i)) {
+			availible_foreign_function_ids.push_back(i);
+			foreign_functions[i] = NULL;
+		}
+	}
+
+	//removed unused functions; their instructions stay put until the instructions are next compacted
+	for (auto it = functions.begin(); it != functions.end();) {
+		if (!marked_functions.is_marked(it->first)) {
+			//erase src locations within the ip range of the function entry
+			for (auto it2 = ip_src_map.lower_bound(it->second.start_address); it2 != ip_src_map.lower_bound(it->second.start_address + it->second.length); it2 = ip_src_map.erase(it2)) { }
+
+			//instructions of functions declared by the statement being run are dropped when it's finalized
+			if (it->second.start_address < statement_start) {
+				dead_instructions += it->second.length;
+			}
 
-	for (auto it = foreign_functions.begin(); it != foreign_functions.end();) {
-		if (!marked_foreign_functions.contains(it->first)) {
-			availible_foreign_function_ids.push_back(it->first);
-			it = foreign_functions.erase(it);
+			//erase function entry and make id availible
+			availible_function_ids.push_back(it->first);
+			it = functions.erase(it);
 		}
 		else {
+			it->second.tenured = true;
 			it++;
 		}
 	}
 
-	//sort tables by block start position
-	std::vector<size_t> sorted_tables(marked_tables.begin(), marked_tables.end());
-	std::sort(sorted_tables.begin(), sorted_tables.end(), [this](size_t a, size_t b) -> bool {
-		return tables.at(a).block.start < tables.at(b).block.start;
+	//queue up the tables by block start position, for compaction
+	compaction_queue.clear();
+	for (auto& [table_id, table] : tables) {
+		compaction_queue.push_back(std::make_pair(table_id, table.block.start));
+	}
+	std::sort(compaction_queue.begin(), compaction_queue.end(), [](auto& a, auto& b) -> bool {
+		return a.second < b.second;
 	});
+	compaction_index = 0;
+	compaction_offset = 0;
+	compaction_end = heap.size();
+	clear_free_blocks();
 
-	//compact tables
-	size_t table_offset = 0;
-	for (auto table_id : sorted_tables) {
-		table& table = tables.at(table_id);
-		table.block.capacity = table.count;
+	gc_phase = collection_phase::COMPACTING;
+}
 
-		if (table_offset == table.block.start) {
-			table_offset += table.count;
+bool instance::compact_slice(std::optional<std::chrono::steady_clock::time_point> deadline) noexcept {
+	while (compaction_index < compaction_queue.size()) {
+		if (deadline.has_value() && compaction_index % 64 == 0 && std::chrono::steady_clock::now() >= deadline.value()) {
+			return false;
+		}
+
+		auto [table_id, start] = compaction_queue[compaction_index];
+		compaction_index++;
+
+		//skip tables that were moved to the end of the heap since compaction began
+		auto it = tables.find(table_id);
+		if (it == tables.end() || it->second.block.start != start) {
 			continue;
 		}
 
-		auto start_it = heap.begin() + table.block.start;
-		std::move(start_it, start_it + table.count, heap.begin() + table_offset);
+		table& table = it->second;
+		table.block.capacity = table.count;
+		if (compaction_offset != table.block.start) {
+			if (table.count > 0) { //empty blocks may start past the end of the heap, once it's been trimmed
+				auto start_it = heap.begin() + table.block.start;
+				std::move(start_it, start_it + table.count, heap.begin() + compaction_offset);
+			}
+			table.block.start = compaction_offset;
+		}
+		compaction_offset += table.count;
+	}
+
+	live_slots = compaction_offset + (heap.size() - compaction_end);
+	promoted_slots = 0;
 
-		table.block.start = table_offset;
-		table_offset += table.count;
+	//tables allocated since compaction began sit past compaction_end, and keep the gap before them as a free block
+	if (heap.size() == compaction_end) {
+		heap.erase(heap.begin() + compaction_offset, heap.end());
+	}
+	else if (compaction_end > compaction_offset) {
+		insert_free_block(gc_block(compaction_offset, compaction_end - compaction_offset));
 	}
-	heap.erase(heap.begin() + table_offset, heap.end());
-	free_blocks.clear();
 
-	//removed unused functions
-	for (auto it = functions.begin(); it != functions.end();) {
-		if (!marked_functions.contains(it->first)) {
-			//erase src locations within the ip range of the function entry
-			for (auto it2 = ip_src_map.lower_bound(it->second.start_address); it2 != ip_src_map.lower_bound(it->second.start_address + it->second.length); it2 = ip_src_map.erase(it2)) { }
+	compaction_queue.clear();
+	gc_phase = collection_phase::IDLE;
+	return true;
+}
 
-			//erase function entry and make id availible
-			availible_function_ids.push_back(it->first);
-			it = functions.erase(it);
+void instance::gc_slice() noexcept {
+	auto deadline = std::chrono::steady_clock::now() + gc_slice_budget;
+
+	if (gc_phase == collection_phase::MARKING) {
+		//Marking is finished in one go, on the mark threads, rather than in slices when slices aren't keeping up: foreign
+		//objects have allocated another whole budget since the cycle began, or the old generation grew by so many slots before
+		//it that tracing them a slice at a time would let the heap grow well past them first.
+		std::optional<std::chrono::steady_clock::time_point> mark_deadline = deadline;
+		if (foreign_bytes >= foreign_bytes_limit + gc_heap_budget || (gc_mark_threads > 1 && promoted_slots >= parallel_mark_threshold)) {
+			mark_deadline = std::nullopt;
 		}
-		else {
-			it++;
+		if (!mark_slice(mark_deadline)) {
+			return;
 		}
+
+		//the roots were never barriered, so they're marked again before anything is freed
+		mark_gc_roots();
+		mark_slice(std::nullopt);
+		sweep();
+	}
+	if (gc_phase == collection_phase::COMPACTING) {
+		compact_slice(deadline);
 	}
+}
 
-	//compact instructions after removing unused functions
-	if (compact_instructions) {
-		size_t ip = 0; //sort functions by start address
-		std::vector<uint32_t> sorted_functions(marked_functions.begin(), marked_functions.end());
-		std::sort(sorted_functions.begin(), sorted_functions.end(), [this](uint32_t a, uint32_t b) -> bool {
-			return functions.at(a).start_address < functions.at(b).start_address;
-		});
+void instance::reclaim_statement() noexcept {
+	if (gc_phase == collection_phase::IDLE) {
+		collect_young();
 
-		for (auto function_id : sorted_functions) {
-			function_entry& function = functions.at(function_id);
+		//the statement's functions are kept if a closure of one was reached, or a kept function references it
+		std::vector<uint32_t> kept_functions;
+		for (auto function_id : young_functions) {
+			auto it = functions.find(function_id);
+			if (it != functions.end() && it->second.tenured) {
+				kept_functions.push_back(function_id);
+			}
+		}
+		phmap::flat_hash_set<uint32_t> kept_constants;
+		for (size_t i = 0; i < kept_functions.size(); i++) {
+			function_entry& function = functions.at(kept_functions[i]);
+			for (auto id : function.referenced_functions) {
+				function_entry& referenced = functions.at(id);
+				if (!referenced.tenured) {
+					referenced.tenured = true;
+					kept_functions.push_back(id);
+				}
+			}
+			kept_constants.insert(function.referenced_constants.begin(), function.referenced_constants.end());
+		}
 
-			if (function.start_address == ip) {
-				ip += function.length;
+		for (auto function_id : young_functions) {
+			auto it = functions.find(function_id);
+			if (it == functions.end() || it->second.tenured) {
 				continue;
 			}
 
-			auto start_it = instructions.begin() + function.start_address;
-			std::move(start_it, start_it + function.length, instructions.begin() + ip);
-			
-			std::vector<std::pair<size_t, source_loc>> to_reinsert;
-			size_t offset = function.start_address - ip;
-			for (auto it = ip_src_map.lower_bound(function.start_address); it != ip_src_map.lower_bound(function.start_address + function.length);) {
-				to_reinsert.push_back(std::make_pair(it->first - offset, it->second));
-				it = ip_src_map.erase(it);
-			}
-			for (auto src_loc : to_reinsert) {
-				ip_src_map.insert(src_loc);
+			for (auto it2 = ip_src_map.lower_bound(it->second.start_address); it2 != ip_src_map.lower_bound(it->second.start_address + it->second.length); it2 = ip_src_map.erase(it2)) { }
+			availible_function_ids.push_back(function_id);
+			functions.erase(it);
+		}
+
+		//nothing older can reference the statement's constants, so only kept functions keep them alive
+		for (auto id : young_constants) {
+			if ((constants[id].flags & value::flags::INVALID_CONSTANT) || kept_constants.contains(id)) {
+				continue;
 			}
 
-			function.start_address = ip;
+			constant_hashses.erase(constants[id].hash());
+			availible_constant_ids.push_back(id);
+			constants[id].flags |= value::flags::INVALID_CONSTANT;
+		}
+
+		//full collections are paced the same way as from allocations, which may not otherwise need one for a while
+		if (promoted_slots > live_slots || promoted_foreign_bytes > live_foreign_bytes) {
+			begin_major_collection();
+		}
+	}
+	else {
+		//the collection in progress decides what lives; it already treats what the statement added like everything else
+		gc_slice();
+	}
+
+	for (auto function_id : young_functions) {
+		auto it = functions.find(function_id);
+		if (it != functions.end()) {
+			it->second.tenured = true;
+		}
+	}
+	young_functions.clear();
+	young_constants.clear();
+
+	if (dead_instructions * 2 > instructions.size()) {
+		compact_instructions(0);
+		dead_instructions = 0;
+	}
+	else {
+		compact_instructions(statement_start);
+	}
+}
+
+void instance::compact_instructions(size_t from) noexcept {
+	size_t ip = from; //sort functions by start address
+	std::vector<uint32_t> sorted_functions;
+	for (auto& [function_id, function] : functions) {
+		if (function.start_address >= from) {
+			sorted_functions.push_back(function_id);
+		}
+	}
+	std::sort(sorted_functions.begin(), sorted_functions.end(), [this](uint32_t a, uint32_t b) -> bool {
+		return functions.at(a).start_address < functions.at(b).start_address;
+	});
+
+	for (auto function_id : sorted_functions) {
+		function_entry& function = functions.at(function_id);
+
+		if (function.start_address == ip) {
 			ip += function.length;
+			continue;
+		}
+
+		auto start_it = instructions.begin() + function.start_address;
+		std::move(start_it, start_it + function.length, instructions.begin() + ip);
+		
+		std::vector<std::pair<size_t, source_loc>> to_reinsert;
+		size_t offset = function.start_address - ip;
+		for (auto it = ip_src_map.lower_bound(function.start_address); it != ip_src_map.lower_bound(function.start_address + function.length);) {
+			to_reinsert.push_back(std::make_pair(it->first - offset, it->second));
+			it = ip_src_map.erase(it);
+		}
+		for (auto src_loc : to_reinsert) {
+			ip_src_map.insert(src_loc);
 		}
-		instructions.erase(instructions.begin() + ip, instructions.end());
-		ip = instructions.size();
+
+		function.start_address = ip;
+		ip += function.length;
 	}
+	instructions.erase(instructions.begin() + ip, instructions.end());
+	ip_src_map.erase(ip_src_map.lower_bound(ip), ip_src_map.end());
 }
\ No newline at end of file
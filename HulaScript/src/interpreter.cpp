@@ -6,28 +6,35 @@
 
 using namespace HulaScript;
 
+//Handlers end with NEXT(), which moves on to the following instruction, or DISPATCH() once they've set ip themselves.
+//The loop ends on the HALT at the end of the code being executed, or the RETURN out of a function invoke_value called, so
+//there's no bounds check per instruction.
+//Superinstructions reach the handler for the rest of their sequence with a goto to its label.
+#define CASE(op) case opcode::op:
+#define DISPATCH() continue
+#define NEXT() ip++; DISPATCH()
+
 void instance::execute() {
-	while (ip != instructions.size())
-	{
-		instruction& ins = instructions[ip];
+	for (;;) {
+		instruction ins = instructions[ip];
 
 		switch (ins.operation)
 		{
-		case opcode::DUPLICATE_TOP:
+		CASE(DUPLICATE_TOP)
 			evaluation_stack.push_back(evaluation_stack.back());
-			break;
-		case opcode::DISCARD_TOP:
+			NEXT();
+		CASE(DISCARD_TOP)
 			evaluation_stack.pop_back();
-			break;
-		case opcode::BRING_TO_TOP: {
+			NEXT();
+		CASE(BRING_TO_TOP) {
 			evaluation_stack.push_back(*(evaluation_stack.end() - (ins.operand + 1)));
-			break;
+			NEXT();
 		}
 
-		case opcode::LOAD_CONSTANT_FAST:
+		CASE(LOAD_CONSTANT_FAST)
 			evaluation_stack.push_back(constants[ins.operand]);
-			break;
-		case opcode::LOAD_CONSTANT: {
+			NEXT();
+		CASE(LOAD_CONSTANT) {
 			uint32_t index = ins.operand;
 			instruction& payload = instructions[ip + 1];
 
@@ -37,206 +44,188 @@ void instance::execute() {
 			evaluation_stack.push_back(constants[index]);
 
 			ip++;
-			break;
+			NEXT();
 		}
-		case opcode::PUSH_NIL:
+		CASE(PUSH_NIL)
 			evaluation_stack.push_back(value());
-			break;
-		case opcode::PUSH_TRUE:
+			NEXT();
+		CASE(PUSH_TRUE)
 			evaluation_stack.push_back(value(true));
-			break;
-		case opcode::PUSH_FALSE:
+			NEXT();
+		CASE(PUSH_FALSE)
 			evaluation_stack.push_back(value(false));
-			break;
+			NEXT();
 
-		case opcode::DECL_TOPLVL_LOCAL:
+		CASE(DECL_TOPLVL_LOCAL)
 			declared_top_level_locals++;
 			[[fallthrough]];
-		case opcode::DECL_LOCAL:
+		CASE(DECL_LOCAL)
 			assert(local_offset + ins.operand == locals.size());
 			locals.push_back(evaluation_stack.back());
 			evaluation_stack.pop_back();
-			break;
-		case opcode::PROBE_LOCALS:
+			NEXT();
+		CASE(PROBE_LOCALS)
 			locals.reserve(local_offset + ins.operand);
-			break;
-		case opcode::UNWIND_LOCALS:
+			NEXT();
+		CASE(UNWIND_LOCALS)
 			locals.erase(locals.end() - ins.operand, locals.end());
-			break;
-		case opcode::STORE_LOCAL:
+			NEXT();
+		CASE(STORE_LOCAL)
 			locals[local_offset + ins.operand] = evaluation_stack.back();
-			break;
-		case opcode::LOAD_LOCAL:
+			NEXT();
+		CASE(LOAD_LOCAL)
 			evaluation_stack.push_back(locals[local_offset + ins.operand]);
-			break;
+			NEXT();
+		CASE(STORE_LOCAL_DISCARD)
+			locals[local_offset + ins.operand] = evaluation_stack.back();
+			evaluation_stack.pop_back();
+			ip += 2;
+			DISPATCH();
+		CASE(LOAD_LOCAL_ADD_CONST) {
+			value a = locals[local_offset + ins.operand];
+			value b = constants[instructions[ip + 1].operand];
+			ip += 2; //any panic is reported at the add
+
+			if (a.type == value::vtype::NUMBER && b.type == value::vtype::NUMBER) {
+				evaluation_stack.push_back(value(a.data.number + b.data.number));
+				NEXT();
+			}
+
+			evaluation_stack.push_back(a);
+			evaluation_stack.push_back(b);
+			ins = instructions[ip];
+			goto ADD_handler;
+		}
 
-		case opcode::DECL_GLOBAL:
+		CASE(DECL_GLOBAL)
 			assert(globals.size() == ins.operand);
 			globals.push_back(evaluation_stack.back());
 			evaluation_stack.pop_back();
-			break;
-		case opcode::STORE_GLOBAL:
+			NEXT();
+		CASE(STORE_GLOBAL)
 			globals[ins.operand] = evaluation_stack.back();
-			break;
-		case opcode::LOAD_GLOBAL:
+			NEXT();
+		CASE(LOAD_GLOBAL)
 			evaluation_stack.push_back(globals[ins.operand]);
-			break;
+			NEXT();
 
 		//table operations
-		case opcode::LOAD_TABLE: {
+		CASE(INVOKE_PROPERTY)
+			[[fallthrough]];
+		CASE(LOAD_TABLE) {
 			value key = evaluation_stack.back();
-			size_t hash = key.hash();
 			evaluation_stack.pop_back();
 
 			value table_value = evaluation_stack.back();
 			evaluation_stack.pop_back();
 
-			if(table_value.type == value::vtype::FOREIGN_OBJECT) {
-				evaluation_stack.push_back(table_value.data.foreign_object->load_property(hash, *this));
-				break;
-			}
-
-			table_value.expect_type(value::vtype::TABLE, *this);
-			uint16_t flags = table_value.flags;
-			size_t table_id = table_value.data.id;
-
-			for (;;) {
-				table& table = tables.at(table_id);
+			//property names are constant, so only those go through the inline cache
+			inline_cache* cache = NULL;
+			if (key.type == value::vtype::INTERNAL_STRHASH && (table_value.type == value::vtype::TABLE || table_value.type == value::vtype::FOREIGN_OBJECT)) {
+				cache = &inline_caches[ip % inline_cache_sets];
 
-				auto it = table.key_hashes.find(hash);
-				if (it != table.key_hashes.end()) {
-					evaluation_stack.push_back(heap[table.block.start + it->second]);
-					break;
+				table* receiver_table = NULL;
+				size_t receiver;
+				if (table_value.type == value::vtype::TABLE) {
+					receiver_table = &tables.at(table_value.data.id);
+					receiver = reinterpret_cast<size_t>(receiver_table->layout);
 				}
-				else if (hash == Hash::dj2b("@length")) {
-					evaluation_stack.push_back(value(static_cast<double>(table.count)));
-					break;
+				else {
+					receiver = reinterpret_cast<size_t>(&typeid(*table_value.data.foreign_object));
 				}
-				else if (flags & value::flags::TABLE_ARRAY_ITERATE) {
-					switch (hash)
-					{
-					case Hash::dj2b("iterator"):
-						evaluation_stack.push_back(value(value::vtype::INTERNAL_TABLE_GET_ITERATOR, flags, 0, table_id));
-						break;
-					case Hash::dj2b("filter"):
-						evaluation_stack.push_back(value(value::vtype::INTERNAL_TABLE_FILTER, flags, 0, table_id));
-						break;
-					case Hash::dj2b("append"):
-						evaluation_stack.push_back(value(value::vtype::INTERNAL_TABLE_APPEND, flags, 0, table_id));
-						break;
-					case Hash::dj2b("appendRange"):
-						evaluation_stack.push_back(value(value::vtype::INTERNAL_TABLE_APPEND_RANGE, flags, 0, table_id));
-						break;
-					default:
-						evaluation_stack.push_back(value());
-						break;
+
+				for (auto& entry : cache->entries) {
+					if (entry.receiver != receiver || entry.name_hash != key.data.id || entry.receiver_type != table_value.type) {
+						continue;
 					}
-					break;
-				}
-				else if(flags & value::flags::TABLE_INHERITS_PARENT) {
-					size_t& base_table_index = table.key_hashes.at(Hash::dj2b("base"));
-					value& base_table_val = heap[table.block.start + base_table_index];
-					flags = base_table_val.flags;
-					table_id = base_table_val.data.id;
-				}
-				else {
-					evaluation_stack.push_back(value());
-					break;
+
+					inline_cache_hits++;
+					if (receiver_table != NULL) {
+						evaluation_stack.push_back(heap[receiver_table->block.start + entry.slot]);
+					}
+					else {
+						evaluation_stack.push_back(value(entry.slot, table_value.data.foreign_object));
+					}
+					goto load_table_done;
 				}
+				inline_cache_misses++;
 			}
-			break;
+			evaluation_stack.push_back(load_table(table_value, key, cache));
 		}
-		case opcode::STORE_TABLE: {
+		load_table_done:
+			if (ins.operation == opcode::INVOKE_PROPERTY) {
+				ip++;
+				ins = instructions[ip];
+				goto CALL_handler;
+			}
+			NEXT();
+		CASE(STORE_TABLE_DISCARD)
+			[[fallthrough]];
+		CASE(STORE_TABLE) {
 			value set_value = evaluation_stack.back();
 			evaluation_stack.pop_back();
 			value key = evaluation_stack.back();
 			evaluation_stack.pop_back();
-			expect_type(value::vtype::TABLE);
 			value table_value = evaluation_stack.back();
-			size_t table_id = table_value.data.id;
-			uint16_t flags = table_value.flags;
 			evaluation_stack.pop_back();
 
-			size_t hash = key.hash();
-
-			for (;;) {
-				table& table = tables.at(table_id);
-				auto it = table.key_hashes.find(hash);
-				if (it != table.key_hashes.end()) {
-					evaluation_stack.push_back(heap[table.block.start + it->second] = set_value);
-					break;
-				}
-				else if (flags & value::flags::TABLE_INHERITS_PARENT && ins.operand) {
-					size_t& base_table_index = table.key_hashes.at(Hash::dj2b("base"));
-					value& base_table_val = heap[table.block.start + base_table_index];
-					flags = base_table_val.flags;
-					table_id = base_table_val.data.id;
-				}
-				else {
-					if (flags & value::flags::TABLE_IS_FINAL) {
-						panic("Cannot add to an immutable table.");
-					}
-					if (table.count == table.block.capacity) {
-						temp_gc_exempt.push_back(table_value);
-						temp_gc_exempt.push_back(set_value);
-						reallocate_table(table_id, table.block.capacity == 0 ? 4 : table.block.capacity * 2, true);
-						temp_gc_exempt.clear();
-					}
+			store_table(table_value, key, set_value, ins.operand);
 
-					table.key_hashes.insert({ hash, table.count });
-					evaluation_stack.push_back(heap[table.block.start + table.count] = set_value);
-					table.count++;
-					break;
-				}
+			if (ins.operation == opcode::STORE_TABLE_DISCARD) {
+				ip++;
 			}
-			break;
+			else {
+				evaluation_stack.push_back(set_value);
+			}
+			NEXT();
 		}
-		case opcode::ALLOCATE_TABLE: {
+		CASE(ALLOCATE_TABLE) {
 			expect_type(value::vtype::NUMBER);
 			value length = evaluation_stack.back();
 			evaluation_stack.pop_back();
 
 			size_t table_id = allocate_table(static_cast<size_t>(length.data.number), true);
 			evaluation_stack.push_back(value(value::vtype::TABLE, value::flags::NONE, 0, table_id));
-			break;
+			NEXT();
 		}
-		case opcode::ALLOCATE_TABLE_LITERAL: {
+		CASE(ALLOCATE_TABLE_LITERAL) {
 			size_t table_id = allocate_table(static_cast<size_t>(ins.operand), true);
 			evaluation_stack.push_back(value(value::vtype::TABLE, value::flags::TABLE_ARRAY_ITERATE, 0, table_id));
-			break;
+			NEXT();
 		}
-		case opcode::ALLOCATE_CLASS: {
+		CASE(ALLOCATE_CLASS) {
 			size_t table_id = allocate_table(static_cast<size_t>(ins.operand), true);
 			evaluation_stack.push_back(value(value::vtype::TABLE, 0, 0, table_id));
-			break;
+			NEXT();
 		}
-		case opcode::ALLOCATE_INHERITED_CLASS: {
+		CASE(ALLOCATE_INHERITED_CLASS) {
 			size_t table_id = allocate_table(static_cast<size_t>(ins.operand) + 1, true);
 			evaluation_stack.push_back(value(value::vtype::TABLE, 0 | value::flags::TABLE_INHERITS_PARENT, 0, table_id));
-			break;
+			NEXT();
 		}
-		case opcode::FINALIZE_TABLE: {
+		CASE(FINALIZE_TABLE) {
 			expect_type(value::vtype::TABLE);
 			evaluation_stack.back().flags |= value::flags::TABLE_IS_FINAL;
 
 			size_t table_id = evaluation_stack.back().data.id;
 			reallocate_table(table_id, tables.at(table_id).count, true);
 
-			break;
+			NEXT();
 		}
 
 		//arithmetic operations
-		case opcode::ADD:
+		CASE(ADD)
+		ADD_handler:
 			[[fallthrough]];
-		case opcode::SUBTRACT:
+		CASE(SUBTRACT)
 			[[fallthrough]];
-		case opcode::MULTIPLY:
+		CASE(MULTIPLY)
 			[[fallthrough]];
-		case opcode::DIVIDE:
+		CASE(DIVIDE)
 			[[fallthrough]];
-		case opcode::MODULO:
+		CASE(MODULO)
 			[[fallthrough]];
-		case opcode::EXPONENTIATE:
+		CASE(EXPONENTIATE)
 		{
 			value b = evaluation_stack.back();
 			evaluation_stack.pop_back();
@@ -246,7 +235,7 @@ void instance::execute() {
 			if (a.type == value::vtype::NIL || b.type == value::vtype::NIL) {
 				a.expect_type(value::vtype::NUMBER, *this);
 				b.expect_type(value::vtype::NUMBER, *this);
-				break;
+				NEXT();
 			}
 			
 			operator_handler handler = operator_handlers[ins.operation - opcode::ADD][a.type - value::vtype::NUMBER][b.type - value::vtype::NUMBER];
@@ -256,9 +245,9 @@ void instance::execute() {
 			}
 
 			(this->*handler)(a, b);
-			break;
+			NEXT();
 		}
-		case opcode::MORE: {
+		CASE(MORE) {
 			expect_type(value::vtype::NUMBER);
 			value b = evaluation_stack.back();
 			evaluation_stack.pop_back();
@@ -266,9 +255,9 @@ void instance::execute() {
 			value a = evaluation_stack.back();
 			evaluation_stack.pop_back();
 			evaluation_stack.push_back(value(a.data.number > b.data.number));
-			break;
+			NEXT();
 		}
-		case opcode::LESS: {
+		CASE(LESS) {
 			expect_type(value::vtype::NUMBER);
 			value b = evaluation_stack.back();
 			evaluation_stack.pop_back();
@@ -276,9 +265,9 @@ void instance::execute() {
 			value a = evaluation_stack.back();
 			evaluation_stack.pop_back();
 			evaluation_stack.push_back(value(a.data.number < b.data.number));
-			break;
+			NEXT();
 		}
-		case opcode::LESS_EQUAL: {
+		CASE(LESS_EQUAL) {
 			expect_type(value::vtype::NUMBER);
 			value b = evaluation_stack.back();
 			evaluation_stack.pop_back();
@@ -286,9 +275,9 @@ void instance::execute() {
 			value a = evaluation_stack.back();
 			evaluation_stack.pop_back();
 			evaluation_stack.push_back(value(a.data.number <= b.data.number));
-			break;
+			NEXT();
 		}
-		case opcode::MORE_EQUAL: {
+		CASE(MORE_EQUAL) {
 			expect_type(value::vtype::NUMBER);
 			value b = evaluation_stack.back();
 			evaluation_stack.pop_back();
@@ -296,74 +285,80 @@ void instance::execute() {
 			value a = evaluation_stack.back();
 			evaluation_stack.pop_back();
 			evaluation_stack.push_back(value(a.data.number >= b.data.number));
-			break;
+			NEXT();
 		}
-		case opcode::EQUALS: {
+		CASE(EQUALS) {
 			value b = evaluation_stack.back();
 			evaluation_stack.pop_back();
 			value a = evaluation_stack.back();
 			evaluation_stack.pop_back();
 			evaluation_stack.push_back(value(a.hash() == b.hash()));
-			break;
+			NEXT();
 		}
-		case opcode::NOT_EQUAL: {
+		CASE(NOT_EQUAL) {
 			value b = evaluation_stack.back();
 			evaluation_stack.pop_back();
 			value a = evaluation_stack.back();
 			evaluation_stack.pop_back();
 			evaluation_stack.push_back(value(a.hash() != b.hash()));
-			break;
+			NEXT();
 		}
-		case opcode::IFNT_NIL_JUMP_AHEAD: {
+		CASE(IFNT_NIL_JUMP_AHEAD) {
 			if (evaluation_stack.back().type == value::vtype::NIL) {
 				evaluation_stack.pop_back();
-				break;
+				NEXT();
 			}
 			else {
 				ip += ins.operand;
-				continue;
+				DISPATCH();
 			}
 		}
 
 		//jump and conditional operators
-		case opcode::IF_FALSE_JUMP_AHEAD: {
+		CASE(IF_FALSE_JUMP_AHEAD) {
 			expect_type(value::vtype::BOOLEAN);
 			bool cond = evaluation_stack.back().data.boolean;
 			evaluation_stack.pop_back();
 
 			if (cond) {
-				break;
+				NEXT();
 			}
 		}
 		[[fallthrough]];
-		case opcode::JUMP_AHEAD:
+		CASE(JUMP_AHEAD)
 			ip += ins.operand;
-			continue;
-		case opcode::IF_FALSE_JUMP_BACK: {
+			DISPATCH();
+		CASE(IF_FALSE_JUMP_BACK) {
 			expect_type(value::vtype::BOOLEAN);
 			bool cond = evaluation_stack.back().data.boolean;
 			evaluation_stack.pop_back();
 
 			if (!cond) {
-				break;
+				NEXT();
 			}
 		}
 		[[fallthrough]];
-		case opcode::JUMP_BACK:
+		CASE(JUMP_BACK)
 			ip -= ins.operand;
-			continue;
 
-		case opcode::CALL: {
-			//push arguments into local variable stack
-			size_t local_count = locals.size();
-			locals.insert(locals.end(), evaluation_stack.end() - ins.operand, evaluation_stack.end());
-			evaluation_stack.erase(evaluation_stack.end() - ins.operand, evaluation_stack.end());
-			
-			value call_value = evaluation_stack.back();
-			evaluation_stack.pop_back();
+			//loop back edges are safe points, since every live value is on the evaluation stack or in a variable
+			if (nested_executions == 0) {
+				gc_safe_point();
+			}
+			DISPATCH();
+
+		CASE(CALL)
+		CALL_handler: {
+			//arguments stay on the evaluation stack, above the value being called, until the call returns
+			value call_value = evaluation_stack[evaluation_stack.size() - (ins.operand + 1)];
 			switch (call_value.type)
 			{
 			case value::vtype::CLOSURE: {
+				//push arguments into local variable stack
+				size_t local_count = locals.size();
+				locals.insert(locals.end(), evaluation_stack.end() - ins.operand, evaluation_stack.end());
+				evaluation_stack.erase(evaluation_stack.end() - (ins.operand + 1), evaluation_stack.end());
+
 				extended_offsets.push_back(static_cast<operand>(local_count - local_offset));
 				local_offset = local_count;
 				return_stack.push_back(ip); //push return address
@@ -378,73 +373,19 @@ void instance::execute() {
 					panic(ss.str());
 				}
 				ip = function.start_address;
-				continue;
-			}
-			case value::vtype::FOREIGN_OBJECT_METHOD: {
-				std::vector<value> arguments(locals.end() - ins.operand, locals.end());
-				locals.erase(locals.end() - ins.operand, locals.end());
-				evaluation_stack.push_back(call_value.data.foreign_object->call_method(call_value.function_id, arguments, *this));
-				break;
-			}
-			case value::vtype::FOREIGN_FUNCTION: {
-				std::vector<value> arguments(locals.end() - ins.operand, locals.end());
-				locals.erase(locals.end() - ins.operand, locals.end());
-
-				evaluation_stack.push_back(foreign_functions[call_value.function_id](arguments, *this));
-
-				break;
-			}
-			case value::vtype::INTERNAL_TABLE_GET_ITERATOR: {
-				if (ins.operand != 0) {
-					panic("Array table iterator expects precisley 0 arguments.");
-				}
-				
-				evaluation_stack.push_back(add_foreign_object(std::make_unique<table_iterator>(table_iterator(value(value::vtype::TABLE, call_value.flags, 0, call_value.data.id), *this))));
-				break;
-			}
-			case value::vtype::INTERNAL_TABLE_FILTER: {
-				if (ins.operand != 1) {
-					panic("Array filter expects 1 argument, filter function.");
-				}
-
-				value arguments = locals.back();
-				locals.pop_back();
-
-				evaluation_stack.push_back(filter_table(value(value::vtype::TABLE, call_value.flags, 0, call_value.data.id), arguments, *this));
-				break;
+				DISPATCH();
 			}
-			case value::vtype::INTERNAL_TABLE_APPEND: {
-				if (ins.operand != 1) {
-					panic("Array append expects 1 argument, filter function.");
-				}
-
-				value arguments = locals.back();
-				locals.pop_back();
-
-				evaluation_stack.push_back(append_table(value(value::vtype::TABLE, call_value.flags, 0, call_value.data.id), arguments, *this));
-
-				break;
-			}
-			case value::vtype::INTERNAL_TABLE_APPEND_RANGE: {
-				if (ins.operand != 1) {
-					panic("Array append expects 1 argument, filter function.");
-				}
-
-				value arguments = locals.back();
-				locals.pop_back();
-
-				evaluation_stack.push_back(append_range(value(value::vtype::TABLE, call_value.flags, 0, call_value.data.id), arguments, *this));
-
+			default: {
+				std::span<const value> arguments(evaluation_stack.data() + (evaluation_stack.size() - ins.operand), ins.operand);
+				value result = call_native(call_value, arguments);
+				evaluation_stack.erase(evaluation_stack.end() - (ins.operand + 1), evaluation_stack.end());
+				evaluation_stack.push_back(result);
 				break;
 			}
-			default:
-				evaluation_stack.push_back(call_value);
-				expect_type(value::vtype::CLOSURE);
-				break;
 			}
-			break;
+			NEXT();
 		}
-		case opcode::CALL_LABEL: {
+		CASE(CALL_LABEL) {
 			uint32_t id = ins.operand;
 			instruction& payload = instructions[ip + 1];
 
@@ -458,20 +399,24 @@ void instance::execute() {
 			function_entry& function = functions.at(id);
 
 			ip = function.start_address;
-			continue;
+			DISPATCH();
 		}
-		case opcode::RETURN:
+		CASE(RETURN)
 			locals.erase(locals.begin() + local_offset, locals.end());
 			local_offset -= extended_offsets.back();
 			extended_offsets.pop_back();
-			
+
+			if (return_stack.size() == native_return_depth) {
+				return_stack.pop_back();
+				return;
+			}
 			ip = return_stack.back() + 1;
 			return_stack.pop_back();
-			continue;
+			DISPATCH();
 
-		case opcode::CAPTURE_FUNCPTR:
+		CASE(CAPTURE_FUNCPTR)
 			[[fallthrough]];
-		case opcode::CAPTURE_CLOSURE: {
+		CASE(CAPTURE_CLOSURE) {
 			uint32_t id = ins.operand;
 			instruction& payload = instructions[ip + 1];
 
@@ -490,28 +435,150 @@ void instance::execute() {
 			}
 
 			ip++;
-			break;
+			NEXT();
 		}
+		CASE(AND)
+			[[fallthrough]];
+		CASE(OR) //no handler yet, so and/or leave both operands on the stack
+			NEXT();
+
+		CASE(HALT)
+			return;
 		}
+	}
+}
+
+#undef CASE
+#undef DISPATCH
+#undef NEXT
 
-		ip++;
+instance::value HulaScript::instance::call_native(value call_value, std::span<const value> arguments) {
+	switch (call_value.type)
+	{
+	case value::vtype::FOREIGN_OBJECT_METHOD:
+		return call_value.data.foreign_object->call_method(call_value.function_id, arguments, *this);
+	case value::vtype::FOREIGN_FUNCTION:
+		return foreign_functions[call_value.function_id](arguments, *this);
+	case value::vtype::INTERNAL_TABLE_GET_ITERATOR:
+		if (arguments.size() != 0) {
+			panic("Array table iterator expects precisley 0 arguments.");
+		}
+		return add_foreign_object(std::make_unique<table_iterator>(table_iterator(value(value::vtype::TABLE, call_value.flags, 0, call_value.data.id), *this)));
+	case value::vtype::INTERNAL_TABLE_FILTER:
+		if (arguments.size() != 1) {
+			panic("Array filter expects 1 argument, filter function.");
+		}
+		return filter_table(value(value::vtype::TABLE, call_value.flags, 0, call_value.data.id), arguments[0], *this);
+	case value::vtype::INTERNAL_TABLE_APPEND:
+		if (arguments.size() != 1) {
+			panic("Array append expects 1 argument, filter function.");
+		}
+		return append_table(value(value::vtype::TABLE, call_value.flags, 0, call_value.data.id), arguments[0], *this);
+	case value::vtype::INTERNAL_TABLE_APPEND_RANGE:
+		if (arguments.size() != 1) {
+			panic("Array append expects 1 argument, filter function.");
+		}
+		return append_range(value(value::vtype::TABLE, call_value.flags, 0, call_value.data.id), arguments[0], *this);
+	default:
+		call_value.expect_type(value::vtype::CLOSURE, *this);
+		return value();
 	}
 }
 
-void HulaScript::instance::execute_arbitrary(const std::vector<instruction>& arbitrary_ins) {
-	size_t start_ip = instructions.size();
-	size_t old_ip = ip;
-	instructions.insert(instructions.end(), arbitrary_ins.begin(), arbitrary_ins.end());
+instance::value HulaScript::instance::load_table(value table_value, value key, inline_cache* cache) {
+	size_t hash = key.hash();
+
+	if (table_value.type == value::vtype::FOREIGN_OBJECT) {
+		foreign_object* object = table_value.data.foreign_object;
+		value property = object->load_property(hash, *this);
+		if (cache != NULL && property.type == value::vtype::FOREIGN_OBJECT_METHOD && property.data.foreign_object == object && object->has_shared_properties()) {
+			record_inline_cache(*cache, value::vtype::FOREIGN_OBJECT, reinterpret_cast<size_t>(&typeid(*object)), hash, property.function_id);
+		}
+		return property;
+	}
+
+	table_value.expect_type(value::vtype::TABLE, *this);
+	uint16_t flags = table_value.flags;
+	size_t table_id = table_value.data.id;
+
+	for (;;) {
+		table& table = tables.at(table_id);
 
-	auto src_loc = src_from_ip(old_ip);
-	if (src_loc.has_value()) {
-		ip_src_map.insert({ start_ip, src_loc.value() });
+		auto index = find_key(table, key, hash);
+		if (index.has_value()) {
+			//a shape's slots never change, but inherited lookups can't be cached since the base could be swapped
+			if (cache != NULL && table.layout != NULL && table_id == table_value.data.id) {
+				record_inline_cache(*cache, value::vtype::TABLE, reinterpret_cast<size_t>(table.layout), hash, static_cast<uint32_t>(index.value()));
+			}
+			return heap[table.block.start + index.value()];
+		}
+		else if (hash == Hash::dj2b("@length")) {
+			return value(static_cast<double>(table.count));
+		}
+		else if (flags & value::flags::TABLE_ARRAY_ITERATE) {
+			switch (hash)
+			{
+			case Hash::dj2b("iterator"):
+				return value(value::vtype::INTERNAL_TABLE_GET_ITERATOR, flags, 0, table_id);
+			case Hash::dj2b("filter"):
+				return value(value::vtype::INTERNAL_TABLE_FILTER, flags, 0, table_id);
+			case Hash::dj2b("append"):
+				return value(value::vtype::INTERNAL_TABLE_APPEND, flags, 0, table_id);
+			case Hash::dj2b("appendRange"):
+				return value(value::vtype::INTERNAL_TABLE_APPEND_RANGE, flags, 0, table_id);
+			default:
+				return value();
+			}
+		}
+		else if (flags & value::flags::TABLE_INHERITS_PARENT) {
+			size_t base_table_index = find_hash(table, Hash::dj2b("base")).value();
+			value& base_table_val = heap[table.block.start + base_table_index];
+			flags = base_table_val.flags;
+			table_id = base_table_val.data.id;
+		}
+		else {
+			return value();
+		}
 	}
+}
 
-	ip = start_ip;
-	execute();
+void HulaScript::instance::store_table(value table_value, value key, value set_value, bool store_inherited) {
+	table_value.expect_type(value::vtype::TABLE, *this);
+	size_t table_id = table_value.data.id;
+	uint16_t flags = table_value.flags;
 
-	for (auto it = ip_src_map.lower_bound(start_ip); it != ip_src_map.end(); it = ip_src_map.erase(it)) { }
-	instructions.erase(instructions.begin() + start_ip, instructions.end());
-	ip = old_ip;
-}
\ No newline at end of file
+	size_t hash = key.hash();
+
+	for (;;) {
+		table& table = tables.at(table_id);
+		auto index = find_key(table, key, hash);
+		if (index.has_value()) {
+			write_barrier(table, table_id, set_value);
+			heap[table.block.start + index.value()] = set_value;
+			return;
+		}
+		else if (flags & value::flags::TABLE_INHERITS_PARENT && store_inherited) {
+			size_t base_table_index = find_hash(table, Hash::dj2b("base")).value();
+			value& base_table_val = heap[table.block.start + base_table_index];
+			flags = base_table_val.flags;
+			table_id = base_table_val.data.id;
+		}
+		else {
+			if (flags & value::flags::TABLE_IS_FINAL) {
+				panic("Cannot add to an immutable table.");
+			}
+			if (table.count == table.block.capacity) {
+				temp_gc_exempt.push_back(table_value);
+				temp_gc_exempt.push_back(set_value);
+				reallocate_table(table_id, table.block.capacity == 0 ? 4 : table.block.capacity * 2, true);
+				temp_gc_exempt.clear();
+			}
+
+			insert_key(table, key, hash);
+			write_barrier(table, table_id, set_value);
+			heap[table.block.start + table.count] = set_value;
+			table.count++;
+			return;
+		}
+	}
+}
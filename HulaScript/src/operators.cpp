@@ -1,6 +1,7 @@
 #include <cstring>
 #include <cmath>
 #include <memory>
+#include <numeric>
 #include "HulaScript.h"
 
 using namespace HulaScript;
@@ -9,33 +10,39 @@ instance::operator_handler instance::operator_handlers[(opcode::EXPONENTIATE - o
 	//addition
 	{
 		//operand a is a number
-		{ 
+		{
 			&instance::handle_numerical_add, //operand b is a number
-			NULL, NULL, NULL, NULL, NULL //b cannot be any other type
+			NULL, NULL, NULL, NULL, NULL, NULL //b cannot be any other type
 		},
-		
+
+		//operand a is a rational
+		{
+			&instance::handle_rational_spill_add, &instance::handle_rational_add, //operand b is a rational too
+			&instance::handle_rational_spill_add, &instance::handle_rational_spill_add, &instance::handle_rational_spill_add, &instance::handle_rational_spill_add, &instance::handle_rational_spill_add
+		},
+
 		//operand a is a boolean
-		{ NULL, NULL, NULL, NULL, NULL, NULL},
-		
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
+
 		//operand a is a string
-		{ 
-			NULL, NULL, &instance::handle_string_add, 
+		{
+			NULL, NULL, NULL, &instance::handle_string_add,
 			NULL, NULL, NULL
 		},
-		
+
 		//operand a is a table
 		{
-			&instance::handle_table_add, &instance::handle_table_add, &instance::handle_table_add, 
+			&instance::handle_table_add, &instance::handle_table_add, &instance::handle_table_add, &instance::handle_table_add,
 			&instance::handle_table_add, &instance::handle_table_add, &instance::handle_table_add
 		},
 
 		//operand a is a closure
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a foreign object
-		{ 
-			&instance::handle_foreign_obj_add, &instance::handle_foreign_obj_add, &instance::handle_foreign_obj_add, 
-			&instance::handle_foreign_obj_add, &instance::handle_foreign_obj_add, &instance::handle_foreign_obj_add 
+		{
+			&instance::handle_foreign_obj_add, &instance::handle_foreign_obj_add, &instance::handle_foreign_obj_add, &instance::handle_foreign_obj_add,
+			&instance::handle_foreign_obj_add, &instance::handle_foreign_obj_add, &instance::handle_foreign_obj_add
 		}
 	},
 
@@ -44,27 +51,33 @@ instance::operator_handler instance::operator_handlers[(opcode::EXPONENTIATE - o
 		//operand a is a number
 		{
 			&instance::handle_numerical_subtract, //operand b is a number
-			NULL, NULL, NULL, NULL, NULL //b cannot be any other type
+			NULL, NULL, NULL, NULL, NULL, NULL //b cannot be any other type
+		},
+
+		//operand a is a rational
+		{
+			&instance::handle_rational_spill_subtract, &instance::handle_rational_subtract, //operand b is a rational too
+			&instance::handle_rational_spill_subtract, &instance::handle_rational_spill_subtract, &instance::handle_rational_spill_subtract, &instance::handle_rational_spill_subtract, &instance::handle_rational_spill_subtract
 		},
 
 		//operand a is a boolean
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a string
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a table
-		{ 
-			&instance::handle_table_subtract, &instance::handle_table_subtract, &instance::handle_table_subtract,
-			&instance::handle_table_subtract, &instance::handle_table_subtract, &instance::handle_table_subtract 
+		{
+			&instance::handle_table_subtract, &instance::handle_table_subtract, &instance::handle_table_subtract, &instance::handle_table_subtract,
+			&instance::handle_table_subtract, &instance::handle_table_subtract, &instance::handle_table_subtract
 		},
 
 		//operand a is a closure
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a foreign object
 		{
-			&instance::handle_foreign_obj_subtract, &instance::handle_foreign_obj_subtract, &instance::handle_foreign_obj_subtract,
+			&instance::handle_foreign_obj_subtract, &instance::handle_foreign_obj_subtract, &instance::handle_foreign_obj_subtract, &instance::handle_foreign_obj_subtract,
 			&instance::handle_foreign_obj_subtract, &instance::handle_foreign_obj_subtract, &instance::handle_foreign_obj_subtract
 		}
 	},
@@ -74,32 +87,38 @@ instance::operator_handler instance::operator_handlers[(opcode::EXPONENTIATE - o
 		//operand a is a number
 		{
 			&instance::handle_numerical_multiply, //operand b is a number
-			NULL, NULL, 
+			NULL, NULL, NULL,
 			&instance::handle_table_repeat, //allocate table by multiplying it by a number
 			NULL, NULL //b cannot be any other type
 		},
 
+		//operand a is a rational
+		{
+			&instance::handle_rational_spill_multiply, &instance::handle_rational_multiply, //operand b is a rational too
+			&instance::handle_rational_spill_multiply, &instance::handle_rational_spill_multiply, &instance::handle_rational_spill_multiply, &instance::handle_rational_spill_multiply, &instance::handle_rational_spill_multiply
+		},
+
 		//operand a is a boolean
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a string
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a table
-		{ 
-			&instance::handle_table_multiply, &instance::handle_table_multiply, &instance::handle_table_multiply, 
-			&instance::handle_table_multiply, &instance::handle_table_multiply, &instance::handle_table_multiply 
+		{
+			&instance::handle_table_multiply, &instance::handle_table_multiply, &instance::handle_table_multiply, &instance::handle_table_multiply,
+			&instance::handle_table_multiply, &instance::handle_table_multiply, &instance::handle_table_multiply
 		},
 
 		//operand a is a closure
-		{ 
-			&instance::handle_closure_multiply, &instance::handle_closure_multiply, &instance::handle_closure_multiply, 
-			&instance::handle_closure_multiply, &instance::handle_closure_multiply, &instance::handle_closure_multiply 
+		{
+			&instance::handle_closure_multiply, &instance::handle_closure_multiply, &instance::handle_closure_multiply, &instance::handle_closure_multiply,
+			&instance::handle_closure_multiply, &instance::handle_closure_multiply, &instance::handle_closure_multiply
 		},
 
 		//operand a is a foreign object
 		{
-			&instance::handle_foreign_obj_multiply, &instance::handle_foreign_obj_multiply, &instance::handle_foreign_obj_multiply,
+			&instance::handle_foreign_obj_multiply, &instance::handle_foreign_obj_multiply, &instance::handle_foreign_obj_multiply, &instance::handle_foreign_obj_multiply,
 			&instance::handle_foreign_obj_multiply, &instance::handle_foreign_obj_multiply, &instance::handle_foreign_obj_multiply
 		}
 	},
@@ -108,85 +127,106 @@ instance::operator_handler instance::operator_handlers[(opcode::EXPONENTIATE - o
 	{
 		//operand a is a number
 		{
-			&instance::handle_numerical_divide, //operand b is a number too
-			NULL, NULL, NULL, NULL, NULL //b cannot be any other type
+			&instance::handle_numerical_divide, //operand b is a number
+			NULL, NULL, NULL, NULL, NULL, NULL //b cannot be any other type
+		},
+
+		//operand a is a rational
+		{
+			&instance::handle_rational_spill_divide, &instance::handle_rational_divide, //operand b is a rational too
+			&instance::handle_rational_spill_divide, &instance::handle_rational_spill_divide, &instance::handle_rational_spill_divide, &instance::handle_rational_spill_divide, &instance::handle_rational_spill_divide
 		},
 
 		//operand a is a boolean
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a string
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a table
-		{ 
-			&instance::handle_table_divide, &instance::handle_table_divide, &instance::handle_table_divide, 
-			&instance::handle_table_divide, &instance::handle_table_divide, &instance::handle_table_divide },
+		{
+			&instance::handle_table_divide, &instance::handle_table_divide, &instance::handle_table_divide, &instance::handle_table_divide,
+			&instance::handle_table_divide, &instance::handle_table_divide, &instance::handle_table_divide
+		},
 
 		//operand a is a closure
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a foreign object
 		{
-			&instance::handle_foreign_obj_divide, &instance::handle_foreign_obj_divide, &instance::handle_foreign_obj_divide,
+			&instance::handle_foreign_obj_divide, &instance::handle_foreign_obj_divide, &instance::handle_foreign_obj_divide, &instance::handle_foreign_obj_divide,
 			&instance::handle_foreign_obj_divide, &instance::handle_foreign_obj_divide, &instance::handle_foreign_obj_divide
 		}
 	},
 
 	//modulo
 	{
+		//operand a is a number
+		{
+			&instance::handle_numerical_modulo, //operand b is a number
+			NULL, NULL, NULL, NULL, NULL, NULL //b cannot be any other type
+		},
+
+		//operand a is a rational
 		{
-			&instance::handle_numerical_modulo, //operand b is a number too
-			NULL, NULL, NULL, NULL, NULL //b cannot be any other type
+			&instance::handle_rational_spill_modulo, &instance::handle_rational_spill_modulo, &instance::handle_rational_spill_modulo, &instance::handle_rational_spill_modulo,
+			&instance::handle_rational_spill_modulo, &instance::handle_rational_spill_modulo, &instance::handle_rational_spill_modulo
 		},
 
 		//operand a is a boolean
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a string
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a table
-		{ 
-			&instance::handle_table_modulo, &instance::handle_table_modulo, &instance::handle_table_modulo, 
-			&instance::handle_table_modulo, &instance::handle_table_modulo, &instance::handle_table_modulo 
+		{
+			&instance::handle_table_modulo, &instance::handle_table_modulo, &instance::handle_table_modulo, &instance::handle_table_modulo,
+			&instance::handle_table_modulo, &instance::handle_table_modulo, &instance::handle_table_modulo
 		},
 
 		//operand a is a closure
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a foreign object
 		{
-			&instance::handle_foreign_obj_modulo, &instance::handle_foreign_obj_modulo, &instance::handle_foreign_obj_modulo,
+			&instance::handle_foreign_obj_modulo, &instance::handle_foreign_obj_modulo, &instance::handle_foreign_obj_modulo, &instance::handle_foreign_obj_modulo,
 			&instance::handle_foreign_obj_modulo, &instance::handle_foreign_obj_modulo, &instance::handle_foreign_obj_modulo
 		}
 	},
 
 	//exponentiate
 	{
+		//operand a is a number
 		{
-			&instance::handle_numerical_exponentiate, //operand b is a number too
-			NULL, NULL, NULL, NULL, NULL //b cannot be any other type
+			&instance::handle_numerical_exponentiate, //operand b is a number
+			NULL, NULL, NULL, NULL, NULL, NULL //b cannot be any other type
+		},
+
+		//operand a is a rational
+		{
+			&instance::handle_rational_spill_exponentiate, &instance::handle_rational_spill_exponentiate, &instance::handle_rational_spill_exponentiate, &instance::handle_rational_spill_exponentiate,
+			&instance::handle_rational_spill_exponentiate, &instance::handle_rational_spill_exponentiate, &instance::handle_rational_spill_exponentiate
 		},
 
 		//operand a is a boolean
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a string
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a table
-		{ 
-			&instance::handle_table_exponentiate, &instance::handle_table_exponentiate, &instance::handle_table_exponentiate, 
-			&instance::handle_table_exponentiate, &instance::handle_table_exponentiate, &instance::handle_table_exponentiate 
+		{
+			&instance::handle_table_exponentiate, &instance::handle_table_exponentiate, &instance::handle_table_exponentiate, &instance::handle_table_exponentiate,
+			&instance::handle_table_exponentiate, &instance::handle_table_exponentiate, &instance::handle_table_exponentiate
 		},
 
 		//operand a is a closure
-		{ NULL, NULL, NULL, NULL, NULL, NULL },
+		{ NULL, NULL, NULL, NULL, NULL, NULL, NULL },
 
 		//operand a is a foreign object
 		{
-			&instance::handle_foreign_obj_exponentiate, &instance::handle_foreign_obj_exponentiate, &instance::handle_foreign_obj_exponentiate,
+			&instance::handle_foreign_obj_exponentiate, &instance::handle_foreign_obj_exponentiate, &instance::handle_foreign_obj_exponentiate, &instance::handle_foreign_obj_exponentiate,
 			&instance::handle_foreign_obj_exponentiate, &instance::handle_foreign_obj_exponentiate, &instance::handle_foreign_obj_exponentiate
 		}
 	}
@@ -216,16 +256,101 @@ void instance::handle_numerical_exponentiate(value& a, value& b) {
 	evaluation_stack.push_back(value(pow(a.data.number, b.data.number)));
 }
 
+instance::value instance::make_rational(int64_t numerator, uint64_t denominator) {
+	uint64_t magnitude = numerator < 0 ? 0 - static_cast<uint64_t>(numerator) : static_cast<uint64_t>(numerator);
+	uint64_t common = std::gcd(magnitude, denominator);
+	magnitude /= common;
+	denominator /= common;
+
+	//both parts stay below 2^31, so handle_rational_* can cross multiply two inline rationals without overflowing 64 bits
+	if (magnitude <= INT32_MAX && denominator <= INT32_MAX) {
+		int32_t small_numerator = static_cast<int32_t>(magnitude);
+		return value(numerator < 0 ? -small_numerator : small_numerator, static_cast<uint32_t>(denominator));
+	}
+
+	if (rational_spiller == NULL) {
+		panic("Numerical Error: Rational is too wide to store inline, and no rational spiller was provided.");
+	}
+	return rational_spiller(numerator < 0 ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude), denominator, *this);
+}
+
+void instance::handle_rational_add(value& a, value& b) {
+	int64_t numerator = static_cast<int64_t>(a.data.rational.numerator) * b.data.rational.denominator + static_cast<int64_t>(b.data.rational.numerator) * a.data.rational.denominator;
+	evaluation_stack.push_back(make_rational(numerator, static_cast<uint64_t>(a.data.rational.denominator) * b.data.rational.denominator));
+}
+
+void instance::handle_rational_subtract(value& a, value& b) {
+	int64_t numerator = static_cast<int64_t>(a.data.rational.numerator) * b.data.rational.denominator - static_cast<int64_t>(b.data.rational.numerator) * a.data.rational.denominator;
+	evaluation_stack.push_back(make_rational(numerator, static_cast<uint64_t>(a.data.rational.denominator) * b.data.rational.denominator));
+}
+
+void instance::handle_rational_multiply(value& a, value& b) {
+	int64_t numerator = static_cast<int64_t>(a.data.rational.numerator) * b.data.rational.numerator;
+	evaluation_stack.push_back(make_rational(numerator, static_cast<uint64_t>(a.data.rational.denominator) * b.data.rational.denominator));
+}
+
+void instance::handle_rational_divide(value& a, value& b) {
+	if (b.data.rational.numerator == 0) {
+		handle_rational_spill_divide(a, b); //the host decides what dividing by zero does
+		return;
+	}
+
+	int64_t numerator = static_cast<int64_t>(a.data.rational.numerator) * b.data.rational.denominator;
+	int64_t denominator = static_cast<int64_t>(a.data.rational.denominator) * b.data.rational.numerator;
+	if (denominator < 0) {
+		numerator = -numerator;
+		denominator = -denominator;
+	}
+	evaluation_stack.push_back(make_rational(numerator, static_cast<uint64_t>(denominator)));
+}
+
+instance::value instance::spill_rational(value& rational) {
+	if (rational_spiller == NULL) {
+		panic("Numerical Error: Cannot operate on a rational without a rational spiller.");
+	}
+	return rational_spiller(rational.data.rational.numerator, rational.data.rational.denominator, *this);
+}
+
+void instance::handle_rational_spill_add(value& a, value& b) {
+	value spilled = spill_rational(a);
+	handle_foreign_obj_add(spilled, b);
+}
+
+void instance::handle_rational_spill_subtract(value& a, value& b) {
+	value spilled = spill_rational(a);
+	handle_foreign_obj_subtract(spilled, b);
+}
+
+void instance::handle_rational_spill_multiply(value& a, value& b) {
+	value spilled = spill_rational(a);
+	handle_foreign_obj_multiply(spilled, b);
+}
+
+void instance::handle_rational_spill_divide(value& a, value& b) {
+	value spilled = spill_rational(a);
+	handle_foreign_obj_divide(spilled, b);
+}
+
+void instance::handle_rational_spill_modulo(value& a, value& b) {
+	value spilled = spill_rational(a);
+	handle_foreign_obj_modulo(spilled, b);
+}
+
+void instance::handle_rational_spill_exponentiate(value& a, value& b) {
+	value spilled = spill_rational(a);
+	handle_foreign_obj_exponentiate(spilled, b);
+}
+
 void instance::handle_string_add(value& a, value& b) {
 	size_t a_len = strlen(a.data.str);
 	size_t b_len = strlen(b.data.str);
 
-	auto alloc = std::unique_ptr<char[]>(new char[a_len + b_len + 1]);
-	strcpy(alloc.get(), a.data.str);
-	strcpy(alloc.get() + a_len, b.data.str);
+	char* allocated = allocate_string(a_len + b_len);
+	strcpy(allocated, a.data.str);
+	strcpy(allocated + a_len, b.data.str);
 
-	evaluation_stack.push_back(value(alloc.get()));
-	active_strs.insert(std::move(alloc));
+	evaluation_stack.push_back(value(allocated));
+	shade(value(allocated));
 }
 
 void instance::handle_table_add(value& a, value& b) {
@@ -0,0 +1,73 @@
+#include <initializer_list>
+#include "HulaScript.h"
+
+using namespace HulaScript;
+
+//Superinstructions are fused in place: the first instruction of a sequence is rewritten, and the rest are left where they
+//are for its handler to read operands from (and skip over). Nothing moves, so jump offsets and ip_src_map stay valid, and
+//a jump into the middle of a fused sequence still lands on the original instructions.
+void instance::peephole_optimize(std::vector<instruction>& instructions) noexcept {
+	auto matches = [&instructions](size_t ip, std::initializer_list<opcode> sequence) -> bool {
+		if (ip + sequence.size() > instructions.size()) {
+			return false;
+		}
+		for (opcode operation : sequence) {
+			if (instructions[ip].operation != operation) {
+				return false;
+			}
+			ip++;
+		}
+		return true;
+	};
+
+	for (size_t ip = 0; ip < instructions.size(); ) {
+		instruction& ins = instructions[ip];
+
+		switch (ins.operation)
+		{
+		case opcode::LOAD_LOCAL:
+			if (matches(ip, { opcode::LOAD_LOCAL, opcode::LOAD_CONSTANT_FAST, opcode::ADD })) {
+				ins.operation = opcode::LOAD_LOCAL_ADD_CONST;
+				ip += 3;
+				continue;
+			}
+			break;
+		case opcode::STORE_LOCAL:
+			if (matches(ip, { opcode::STORE_LOCAL, opcode::DISCARD_TOP })) {
+				ins.operation = opcode::STORE_LOCAL_DISCARD;
+				ip += 2;
+				continue;
+			}
+			break;
+		case opcode::STORE_TABLE:
+			if (matches(ip, { opcode::STORE_TABLE, opcode::DISCARD_TOP })) {
+				ins.operation = opcode::STORE_TABLE_DISCARD;
+				ip += 2;
+				continue;
+			}
+			break;
+		case opcode::LOAD_TABLE:
+			if (matches(ip, { opcode::LOAD_TABLE, opcode::CALL })) {
+				ins.operation = opcode::INVOKE_PROPERTY;
+				ip += 2;
+				continue;
+			}
+			break;
+
+		//the instruction after these is a payload rather than an opcode
+		case opcode::LOAD_CONSTANT:
+			[[fallthrough]];
+		case opcode::CALL_LABEL:
+			[[fallthrough]];
+		case opcode::CAPTURE_FUNCPTR:
+			[[fallthrough]];
+		case opcode::CAPTURE_CLOSURE:
+			ip += 2;
+			continue;
+		default:
+			break;
+		}
+
+		ip++;
+	}
+}
\ No newline at end of file
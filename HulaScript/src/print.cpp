@@ -53,6 +53,7 @@ void instance::value::expect_type(value::vtype expected_type, const instance& in
 	static const char* type_names[] = {
 		"NIL",
 		"NUMBER",
+		"RATIONAL",
 		"BOOLEAN",
 		"STRING",
 		"TABLE",
@@ -238,6 +239,54 @@ std::string instance::get_value_print_string(value to_print_init) {
 		case value::vtype::NUMBER:
 			ss << current.data.number;
 			break;
+		case value::vtype::RATIONAL: {
+			int64_t numerator = current.data.rational.numerator;
+			uint64_t denominator = current.data.rational.denominator;
+			if (denominator == 1) {
+				ss << numerator;
+				break;
+			}
+
+			//formatted as the host formats its precise numbers, without spilling one: a terminating decimal if there is one
+			//whose scale fits in 64 bits, and a fraction otherwise
+			size_t decimal_digits = 0;
+			for (uint64_t denom10 = 1; denom10 % denominator != 0; denom10 *= 10) {
+				if (denom10 > UINT64_MAX / 10) {
+					decimal_digits = 0;
+					break;
+				}
+				decimal_digits++;
+			}
+
+			if (decimal_digits == 0) {
+				ss << numerator << '/' << denominator;
+				break;
+			}
+
+			if (numerator < 0) {
+				ss << '-';
+			}
+			uint64_t magnitude = static_cast<uint64_t>(numerator < 0 ? -numerator : numerator);
+
+			//remainders are below the 32 bit denominator, so long division never overflows
+			std::string fraction;
+			uint64_t remainder = magnitude % denominator;
+			for (size_t i = 0; i < decimal_digits; i++) {
+				remainder *= 10;
+				fraction.push_back(static_cast<char>('0' + remainder / denominator));
+				remainder %= denominator;
+			}
+
+			//like the host, a zero whole part is only written when the fraction starts with a zero
+			if (magnitude >= denominator) {
+				ss << magnitude / denominator;
+			}
+			else if (fraction[0] == '0') {
+				ss << '0';
+			}
+			ss << '.' << fraction;
+			break;
+		}
 
 		case value::vtype::CLOSURE: {
 			function_entry& function = functions.at(current.function_id);
@@ -1,3 +1,4 @@
+#include <sstream>
 #include "HulaScript.h"
 
 using namespace HulaScript;
@@ -9,7 +10,9 @@ void instance::finalize() {
 	evaluation_stack.clear();
 	return_stack.clear();
 	extended_offsets.clear();
-	garbage_collect(true);
+	nested_executions = 0;
+	native_return_depth = 0;
+	reclaim_statement();
 
 	locals.erase(locals.begin() + declared_top_level_locals, locals.end());
 	top_level_local_vars.erase(top_level_local_vars.begin() + declared_top_level_locals, top_level_local_vars.end());
@@ -28,7 +31,9 @@ std::variant<instance::value, std::vector<compilation_error>, std::monostate> in
 		compile(context, repl_mode);
 	}
 	catch (...) {
-		garbage_collect(true);
+		repl_used_functions.clear();
+		repl_used_constants.clear();
+		reclaim_statement();
 		throw;
 	}
 
@@ -66,31 +71,52 @@ std::optional<instance::value> instance::run_loaded() {
 }
 
 instance::value instance::invoke_value(value to_call, std::vector<value> arguments) {
-	evaluation_stack.push_back(to_call);
-	evaluation_stack.insert(evaluation_stack.end(), arguments.begin(), arguments.end());
-	
-	std::vector<instruction> ins;
-	ins.push_back({ .operation = opcode::CALL, .operand = static_cast<operand>(arguments.size()) });
-	execute_arbitrary(ins);
+	if (to_call.type != value::vtype::CLOSURE) {
+		//keeps to_call and the arguments rooted, in case the callee collects
+		size_t base = evaluation_stack.size();
+		evaluation_stack.push_back(to_call);
+		evaluation_stack.insert(evaluation_stack.end(), arguments.begin(), arguments.end());
+
+		value to_return = call_native(to_call, std::span<const value>(evaluation_stack.data() + base + 1, arguments.size()));
+		evaluation_stack.erase(evaluation_stack.begin() + base, evaluation_stack.end());
+		return to_return;
+	}
 
-	value to_return = evaluation_stack.back();
-	evaluation_stack.pop_back();
-	return to_return;
-}
+	//sets up the same frame CALL does, but returning to the ip it was called from counts as returning to here
+	size_t old_ip = ip;
+	size_t old_native_return_depth = native_return_depth;
 
-instance::value instance::invoke_method(value object, std::string method_name, std::vector<value> arguments) {
-	evaluation_stack.push_back(object);
-	evaluation_stack.push_back(value(value::vtype::INTERNAL_STRHASH, 0, 0, Hash::dj2b(method_name.c_str())));
-	std::vector<instruction> ins;
-	ins.push_back({ .operation = opcode::LOAD_TABLE });
-	execute_arbitrary(ins);
+	size_t local_count = locals.size();
+	locals.insert(locals.end(), arguments.begin(), arguments.end());
+	extended_offsets.push_back(static_cast<operand>(local_count - local_offset));
+	local_offset = local_count;
+	return_stack.push_back(ip);
+	native_return_depth = return_stack.size();
 
-	evaluation_stack.insert(evaluation_stack.end(), arguments.begin(), arguments.end());
-	ins.clear();
-	ins.push_back({ .operation = opcode::CALL, .operand = static_cast<operand>(arguments.size()) });
-	execute_arbitrary(ins);
+	function_entry& function = functions.at(to_call.function_id);
+	if (to_call.flags & value::flags::HAS_CAPTURE_TABLE) {
+		locals.push_back(value(value::vtype::TABLE, value::flags::NONE, 0, to_call.data.id));
+	}
+	if (function.parameter_count != arguments.size()) {
+		std::stringstream ss;
+		ss << "Argument Error: Function " << function.name << " expected " << static_cast<size_t>(function.parameter_count) << " argument(s), but got " << arguments.size() << " instead.";
+		panic(ss.str());
+	}
+
+	ip = function.start_address;
+	nested_executions++;
+	execute();
+	nested_executions--;
+
+	native_return_depth = old_native_return_depth;
+	ip = old_ip;
 
 	value to_return = evaluation_stack.back();
 	evaluation_stack.pop_back();
 	return to_return;
-}
\ No newline at end of file
+}
+
+instance::value instance::invoke_method(value object, std::string method_name, std::vector<value> arguments) {
+	value method = load_table(object, value(value::vtype::INTERNAL_STRHASH, 0, 0, Hash::dj2b(method_name.c_str())), NULL);
+	return invoke_value(method, std::move(arguments));
+}
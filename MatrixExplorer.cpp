@@ -2,20 +2,23 @@
 //
 
 #include <iostream>
+#include <sstream>
+#include <chrono>
 #include "repl_completer.h"
 #include "HulaScript.h"
 #include "matrix.h"
+#include "thread_pool.h"
 
 using namespace std;
 
 static bool should_quit = false;
 
-static HulaScript::instance::value quit(std::vector<HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+static HulaScript::instance::value quit(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	should_quit = true;
 	return HulaScript::instance::value();
 }
 
-static HulaScript::instance::value print(std::vector<HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+static HulaScript::instance::value print(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	for (auto argument : arguments) {
 		std::cout << instance.get_value_print_string(argument);
 	}
@@ -23,8 +26,45 @@ static HulaScript::instance::value print(std::vector<HulaScript::instance::value
 	return HulaScript::instance::value(static_cast<double>(arguments.size()));
 }
 
+//sizes both the pool matrix kernels run on and the garbage collector's markers
+static HulaScript::instance::value threads(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+	auto& pool = MatrixExplorer::thread_pool::global();
+	if (arguments.size() > 1) {
+		std::stringstream ss;
+		ss << "Matrix Explorer: threads expects an optional thread count, got " << arguments.size() << " argument(s) instead.";
+		instance.panic(ss.str());
+	}
+	else if (arguments.size() == 1) {
+		pool.set_thread_count(arguments[0].index(1, 1025, instance));
+		instance.set_gc_mark_threads(pool.thread_count());
+	}
+	return HulaScript::instance::value(static_cast<double>(pool.thread_count()));
+}
+
+//seconds since an arbitrary point on a steady clock, so only the difference between two readings means anything
+static HulaScript::instance::value clock_seconds(std::span<const HulaScript::instance::value>, HulaScript::instance&) {
+	return HulaScript::instance::value(std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static HulaScript::instance::value cache_stats(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+	auto stats = instance.get_inline_cache_stats();
+	return instance.make_table_obj({
+		{ "hits", HulaScript::instance::value(static_cast<double>(stats.hits)) },
+		{ "misses", HulaScript::instance::value(static_cast<double>(stats.misses)) }
+	});
+}
+
+static HulaScript::instance::value gc_stats(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+	auto stats = instance.get_gc_stats();
+	return instance.make_table_obj({
+		{ "foreignBytes", HulaScript::instance::value(static_cast<double>(stats.foreign_bytes)) },
+		{ "fullCollections", HulaScript::instance::value(static_cast<double>(stats.full_collections)) },
+		{ "parallelMarks", HulaScript::instance::value(static_cast<double>(stats.parallel_marks)) }
+	});
+}
+
 static HulaScript::instance::value parse_numerical(std::string str, HulaScript::instance& instance) {
-	return instance.add_foreign_object(std::make_unique<MatrixExplorer::matrix::mat_number_type>(MatrixExplorer::rational::parse(str)));
+	return MatrixExplorer::mat_number_type::wrap(MatrixExplorer::rational::parse(str), instance);
 }
 
 int main()
@@ -34,12 +74,19 @@ int main()
 	cout << "\nCall \"help\", \"credits\", or \"license\" for more information.\n" << std::endl;
 
 	HulaScript::repl_completer repl_completer;
-	HulaScript::instance instance(parse_numerical);
+	HulaScript::instance instance(parse_numerical, MatrixExplorer::mat_number_type::spill);
+	instance.set_gc_mark_threads(MatrixExplorer::thread_pool::global().thread_count());
 
 	instance.declare_global("quit", instance.make_foreign_function(quit));
 	instance.declare_global("print", instance.make_foreign_function(print));
-
-	instance.declare_global("mat", instance.make_foreign_function(MatrixExplorer::make_matrix));
+	instance.declare_global("threads", instance.make_foreign_function(threads));
+	instance.declare_global("clock", instance.make_foreign_function(clock_seconds));
+	instance.declare_global("cacheStats", instance.make_foreign_function(cache_stats));
+	instance.declare_global("gcStats", instance.make_foreign_function(gc_stats));
+
+	instance.declare_global("mat", instance.make_foreign_function(MatrixExplorer::make_matrix<MatrixExplorer::rational>));
+	instance.declare_global("matf", instance.make_foreign_function(MatrixExplorer::make_matrix<double>));
+	instance.declare_global("matp", instance.make_foreign_function(MatrixExplorer::make_matrix<MatrixExplorer::prime_field>));
 	instance.declare_global("vec", instance.make_foreign_function(MatrixExplorer::make_vector));
 	instance.declare_global("ident", instance.make_foreign_function(MatrixExplorer::make_identity_matrix));
 	instance.declare_global("zero", instance.make_foreign_function(MatrixExplorer::make_zero_matrix));
@@ -0,0 +1,152 @@
+#include "matrix.h"
+#include "thread_pool.h"
+
+using namespace MatrixExplorer;
+
+//Fraction-free (Bareiss) elimination. The matrix is scaled to integers once, each row by the lcm of its denominators,
+//and every elimination step divides exactly by the previous pivot, so no gcd is taken until results are converted back.
+//Every intermediate entry is a minor of the scaled matrix, so coefficient growth is bounded by the determinant.
+
+namespace {
+	struct fraction_free_result {
+		std::vector<bigint> elems;
+		std::vector<bigint> row_scales; //row_scales[i] is the factor original row i was multiplied by
+		std::vector<size_t> row_origin; //row_origin[i] is the original index of the row now at position i
+		std::vector<size_t> pivot_cols;
+		bigint last_pivot;
+		bool swap_parity;
+	};
+}
+
+static fraction_free_result fraction_free_eliminate(const rational* elems, size_t rows, size_t cols, bool eliminate_above) {
+	fraction_free_result result;
+	result.elems.reserve(rows * cols);
+	result.row_scales.reserve(rows);
+	result.row_origin.reserve(rows);
+	result.last_pivot = bigint(1);
+	result.swap_parity = false;
+
+	for (size_t i = 0; i < rows; i++) {
+		bigint scale(1);
+		for (size_t j = 0; j < cols; j++) {
+			bigint denom = elems[i * cols + j].big_denominator();
+			if (!denom.is_one()) {
+				scale = (scale / bigint::gcd(scale, denom)) * denom;
+			}
+		}
+		for (size_t j = 0; j < cols; j++) {
+			const rational& elem = elems[i * cols + j];
+			result.elems.push_back(scale.is_one() ? elem.big_numerator() : elem.big_numerator() * (scale / elem.big_denominator()));
+		}
+		result.row_scales.push_back(std::move(scale));
+		result.row_origin.push_back(i);
+	}
+
+	std::vector<bigint>& m = result.elems;
+	bigint& prev_pivot = result.last_pivot;
+	size_t r = 0;
+	for (size_t c = 0; c < cols && r < rows; c++) {
+		size_t pivot_row = r;
+		while (pivot_row < rows && m[pivot_row * cols + c].is_zero()) {
+			pivot_row++;
+		}
+		if (pivot_row == rows) {
+			continue;
+		}
+
+		if (pivot_row != r) {
+			std::swap_ranges(m.begin() + r * cols, m.begin() + (r + 1) * cols, m.begin() + pivot_row * cols);
+			std::swap(result.row_origin[r], result.row_origin[pivot_row]);
+			result.swap_parity = !result.swap_parity;
+		}
+
+		//every other row only reads the pivot row, so they're eliminated in parallel
+		bigint pivot = m[r * cols + c];
+		thread_pool::global().parallel_for(eliminate_above ? 0 : r + 1, rows, thread_pool::grain_for(cols), [&](size_t lo, size_t hi) {
+			for (size_t i = lo; i < hi; i++) {
+				if (i == r) {
+					continue;
+				}
+
+				bigint leading = m[i * cols + c];
+				for (size_t j = 0; j < cols; j++) {
+					if (j == c) {
+						continue;
+					}
+
+					bigint& elem = m[i * cols + j];
+					bigint numerator = leading.is_zero() ? pivot * elem : pivot * elem - leading * m[r * cols + j];
+					elem = prev_pivot.is_one() ? std::move(numerator) : numerator / prev_pivot; //exact division
+				}
+				m[i * cols + c] = bigint();
+			}
+		});
+
+		prev_pivot = std::move(pivot);
+		result.pivot_cols.push_back(c);
+		r++;
+	}
+
+	return result;
+}
+
+template<>
+matrix matrix::bareiss_reduce() const noexcept {
+	fraction_free_result ff = fraction_free_eliminate(dense_elems(), rows, cols, false);
+
+	//row k of the classical echelon form is the fraction-free row divided by the previous pivot and its original row scale
+	std::vector<elem_type> new_elems;
+	new_elems.reserve(rows * cols);
+	bigint prev_pivot(1);
+	for (size_t i = 0; i < rows; i++) {
+		bigint denom = prev_pivot.is_one() ? ff.row_scales[ff.row_origin[i]] : ff.row_scales[ff.row_origin[i]] * prev_pivot;
+		if (i < ff.pivot_cols.size()) {
+			prev_pivot = ff.elems[i * cols + ff.pivot_cols[i]];
+		}
+
+		for (size_t j = 0; j < cols; j++) {
+			bigint& elem = ff.elems[i * cols + j];
+			new_elems.push_back(elem.is_zero() ? rational(0) : rational::make_reduced(std::move(elem), denom));
+		}
+	}
+
+	return matrix(rows, cols, new_elems);
+}
+
+template<>
+matrix matrix::bareiss_row_reduce() const noexcept {
+	fraction_free_result ff = fraction_free_eliminate(dense_elems(), rows, cols, true);
+
+	//after fraction-free Gauss-Jordan every pivot equals the last pivot, so one division per element finishes the job
+	std::vector<elem_type> new_elems;
+	new_elems.reserve(rows * cols);
+	for (size_t i = 0; i < rows; i++) {
+		for (size_t j = 0; j < cols; j++) {
+			bigint& elem = ff.elems[i * cols + j];
+			if (elem.is_zero()) {
+				new_elems.push_back(rational(0));
+			}
+			else {
+				new_elems.push_back(rational::make_reduced(std::move(elem), ff.last_pivot));
+			}
+		}
+	}
+
+	return matrix(rows, cols, new_elems);
+}
+
+template<>
+rational matrix::determinant() const noexcept {
+	assert(rows == cols);
+
+	fraction_free_result ff = fraction_free_eliminate(dense_elems(), rows, cols, false);
+	if (ff.pivot_cols.size() < rows) {
+		return rational(0);
+	}
+
+	bigint scale(1);
+	for (auto& row_scale : ff.row_scales) {
+		scale = scale * row_scale;
+	}
+	return rational::make_reduced(ff.swap_parity ? -ff.last_pivot : ff.last_pivot, scale);
+}
@@ -0,0 +1,362 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "bigint.h"
+#include "hash.h"
+
+using namespace MatrixExplorer;
+
+static size_t count_leading_zeros(uint32_t x) noexcept {
+	size_t count = 0;
+	if (x == 0) {
+		return 32;
+	}
+	while (!(x & 0x80000000u)) {
+		x <<= 1;
+		count++;
+	}
+	return count;
+}
+
+bigint bigint::parse(const std::string& digits) {
+	bigint result;
+	for (char c : digits) {
+		if (c < '0' || c > '9') {
+			throw std::invalid_argument("Format: Must be digit (0-9).");
+		}
+
+		//result = result * 10 + digit, done in place limb by limb
+		uint64_t carry = static_cast<uint64_t>(c - '0');
+		for (size_t i = 0; i < result.limbs.size(); i++) {
+			uint64_t cur = static_cast<uint64_t>(result.limbs[i]) * 10 + carry;
+			result.limbs[i] = static_cast<uint32_t>(cur);
+			carry = cur >> 32;
+		}
+		if (carry > 0) {
+			result.limbs.push_back(static_cast<uint32_t>(carry));
+		}
+	}
+	result.trim();
+	return result;
+}
+
+const size_t bigint::bit_length() const noexcept {
+	if (limbs.empty()) {
+		return 0;
+	}
+	return limbs.size() * 32 - count_leading_zeros(limbs.back());
+}
+
+const uint64_t bigint::leading_bits(size_t& shift) const noexcept {
+	size_t bits = bit_length();
+	if (bits <= 64) {
+		shift = 0;
+		return magnitude_uint64();
+	}
+
+	shift = bits - 64;
+	size_t limb_shift = shift / 32;
+	size_t bit_shift = shift % 32;
+
+	uint64_t result = 0;
+	for (size_t i = 0; i < 3 && limb_shift + i < limbs.size(); i++) {
+		uint64_t limb = limbs[limb_shift + i];
+		if (i == 0) {
+			result = limb >> bit_shift;
+		}
+		else {
+			size_t pos = 32 * i - bit_shift;
+			if (pos < 64) {
+				result |= limb << pos;
+			}
+		}
+	}
+	return result;
+}
+
+int bigint::compare_magnitude(const bigint& a, const bigint& b) noexcept {
+	if (a.limbs.size() != b.limbs.size()) {
+		return a.limbs.size() < b.limbs.size() ? -1 : 1;
+	}
+	for (size_t i = a.limbs.size(); i-- > 0; ) {
+		if (a.limbs[i] != b.limbs[i]) {
+			return a.limbs[i] < b.limbs[i] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+int bigint::compare(const bigint& a, const bigint& b) noexcept {
+	if (a.is_negate != b.is_negate) {
+		return a.is_negate ? -1 : 1;
+	}
+	int cmp = compare_magnitude(a, b);
+	return a.is_negate ? -cmp : cmp;
+}
+
+void bigint::add_magnitude(const bigint& a, const bigint& b, bigint& dest) {
+	const bigint& longer = a.limbs.size() >= b.limbs.size() ? a : b;
+	const bigint& shorter = a.limbs.size() >= b.limbs.size() ? b : a;
+
+	dest.limbs.resize(longer.limbs.size());
+	uint64_t carry = 0;
+	for (size_t i = 0; i < longer.limbs.size(); i++) {
+		uint64_t sum = static_cast<uint64_t>(longer.limbs[i]) + carry;
+		if (i < shorter.limbs.size()) {
+			sum += shorter.limbs[i];
+		}
+		dest.limbs[i] = static_cast<uint32_t>(sum);
+		carry = sum >> 32;
+	}
+	if (carry > 0) {
+		dest.limbs.push_back(static_cast<uint32_t>(carry));
+	}
+}
+
+void bigint::subtract_magnitude(const bigint& a, const bigint& b, bigint& dest) {
+	dest.limbs.resize(a.limbs.size());
+	int64_t borrow = 0;
+	for (size_t i = 0; i < a.limbs.size(); i++) {
+		int64_t diff = static_cast<int64_t>(a.limbs[i]) - borrow;
+		if (i < b.limbs.size()) {
+			diff -= b.limbs[i];
+		}
+		borrow = diff < 0 ? 1 : 0;
+		dest.limbs[i] = static_cast<uint32_t>(diff + (borrow << 32));
+	}
+	dest.trim();
+}
+
+bigint bigint::operator+(const bigint& other) const {
+	bigint result;
+	if (is_negate == other.is_negate) {
+		add_magnitude(*this, other, result);
+		result.is_negate = is_negate;
+	}
+	else if (compare_magnitude(*this, other) >= 0) {
+		subtract_magnitude(*this, other, result);
+		result.is_negate = is_negate;
+	}
+	else {
+		subtract_magnitude(other, *this, result);
+		result.is_negate = other.is_negate;
+	}
+	result.trim();
+	return result;
+}
+
+bigint bigint::operator-(const bigint& other) const {
+	return *this + (-other);
+}
+
+bigint bigint::operator*(const bigint& other) const {
+	bigint result;
+	if (limbs.empty() || other.limbs.empty()) {
+		return result;
+	}
+
+	result.limbs.assign(limbs.size() + other.limbs.size(), 0);
+	for (size_t i = 0; i < limbs.size(); i++) {
+		uint64_t carry = 0;
+		uint64_t a = limbs[i];
+		for (size_t j = 0; j < other.limbs.size(); j++) {
+			uint64_t cur = a * other.limbs[j] + result.limbs[i + j] + carry;
+			result.limbs[i + j] = static_cast<uint32_t>(cur);
+			carry = cur >> 32;
+		}
+		result.limbs[i + other.limbs.size()] = static_cast<uint32_t>(carry);
+	}
+	result.is_negate = is_negate != other.is_negate;
+	result.trim();
+	return result;
+}
+
+uint32_t bigint::divide_word(uint32_t divisor) noexcept {
+	uint64_t remainder = 0;
+	for (size_t i = limbs.size(); i-- > 0; ) {
+		uint64_t cur = (remainder << 32) | limbs[i];
+		limbs[i] = static_cast<uint32_t>(cur / divisor);
+		remainder = cur % divisor;
+	}
+	trim();
+	return static_cast<uint32_t>(remainder);
+}
+
+const uint32_t bigint::mod_word(uint32_t modulus) const noexcept {
+	uint64_t remainder = 0;
+	for (size_t i = limbs.size(); i-- > 0; ) {
+		remainder = ((remainder << 32) | limbs[i]) % modulus;
+	}
+	return static_cast<uint32_t>(remainder);
+}
+
+void bigint::divide(const bigint& dividend, const bigint& divisor, bigint& quotient, bigint& remainder) {
+	if (divisor.is_zero()) {
+		throw std::invalid_argument("Cannot divide by zero.");
+	}
+
+	bool quotient_negate = dividend.is_negate != divisor.is_negate;
+	bool remainder_negate = dividend.is_negate;
+
+	if (compare_magnitude(dividend, divisor) < 0) {
+		remainder = dividend;
+		quotient = bigint();
+		return;
+	}
+
+	if (divisor.limbs.size() == 1) {
+		quotient = dividend;
+		uint32_t rem = quotient.divide_word(divisor.limbs[0]);
+		quotient.is_negate = quotient_negate && !quotient.is_zero();
+		remainder = bigint(rem, remainder_negate);
+		return;
+	}
+
+	//Knuth's algorithm D, from The Art of Computer Programming Vol. 2, section 4.3.1
+	size_t n = divisor.limbs.size();
+	size_t m = dividend.limbs.size() - n;
+	size_t shift = count_leading_zeros(divisor.limbs.back());
+
+	//normalize so the top limb of the divisor has its high bit set
+	std::vector<uint32_t> v(n);
+	std::vector<uint32_t> u(dividend.limbs.size() + 1);
+	for (size_t i = n - 1; i > 0; i--) {
+		v[i] = (divisor.limbs[i] << shift) | (shift ? static_cast<uint32_t>(static_cast<uint64_t>(divisor.limbs[i - 1]) >> (32 - shift)) : 0);
+	}
+	v[0] = divisor.limbs[0] << shift;
+	u[dividend.limbs.size()] = shift ? static_cast<uint32_t>(static_cast<uint64_t>(dividend.limbs.back()) >> (32 - shift)) : 0;
+	for (size_t i = dividend.limbs.size() - 1; i > 0; i--) {
+		u[i] = (dividend.limbs[i] << shift) | (shift ? static_cast<uint32_t>(static_cast<uint64_t>(dividend.limbs[i - 1]) >> (32 - shift)) : 0);
+	}
+	u[0] = dividend.limbs[0] << shift;
+
+	std::vector<uint32_t> q(m + 1, 0);
+	const uint64_t base = static_cast<uint64_t>(1) << 32;
+	for (size_t j = m + 1; j-- > 0; ) {
+		//estimate the quotient digit from the top two limbs
+		uint64_t numerator = (static_cast<uint64_t>(u[j + n]) << 32) | u[j + n - 1];
+		uint64_t qhat = numerator / v[n - 1];
+		uint64_t rhat = numerator % v[n - 1];
+		while (qhat >= base || qhat * v[n - 2] > ((rhat << 32) | u[j + n - 2])) {
+			qhat--;
+			rhat += v[n - 1];
+			if (rhat >= base) {
+				break;
+			}
+		}
+
+		//multiply and subtract
+		int64_t borrow = 0;
+		uint64_t carry = 0;
+		for (size_t i = 0; i < n; i++) {
+			uint64_t product = qhat * v[i] + carry;
+			carry = product >> 32;
+			int64_t diff = static_cast<int64_t>(u[i + j]) - borrow - static_cast<int64_t>(product & 0xFFFFFFFFu);
+			borrow = diff < 0 ? 1 : 0;
+			u[i + j] = static_cast<uint32_t>(diff + (borrow << 32));
+		}
+		int64_t diff = static_cast<int64_t>(u[j + n]) - borrow - static_cast<int64_t>(carry);
+		borrow = diff < 0 ? 1 : 0;
+		u[j + n] = static_cast<uint32_t>(diff + (borrow << 32));
+
+		//qhat was one too large, add the divisor back
+		if (borrow) {
+			qhat--;
+			uint64_t add_carry = 0;
+			for (size_t i = 0; i < n; i++) {
+				uint64_t sum = static_cast<uint64_t>(u[i + j]) + v[i] + add_carry;
+				u[i + j] = static_cast<uint32_t>(sum);
+				add_carry = sum >> 32;
+			}
+			u[j + n] = static_cast<uint32_t>(static_cast<uint64_t>(u[j + n]) + add_carry);
+		}
+		q[j] = static_cast<uint32_t>(qhat);
+	}
+
+	quotient.limbs = std::move(q);
+	quotient.is_negate = quotient_negate;
+	quotient.trim();
+
+	//unnormalize the remainder
+	remainder.limbs.assign(n, 0);
+	for (size_t i = 0; i < n; i++) {
+		remainder.limbs[i] = (u[i] >> shift) | (shift ? static_cast<uint32_t>(static_cast<uint64_t>(u[i + 1]) << (32 - shift)) : 0);
+	}
+	remainder.is_negate = remainder_negate;
+	remainder.trim();
+}
+
+bigint bigint::operator/(const bigint& other) const {
+	bigint quotient, remainder;
+	divide(*this, other, quotient, remainder);
+	return quotient;
+}
+
+bigint bigint::operator%(const bigint& other) const {
+	bigint quotient, remainder;
+	divide(*this, other, quotient, remainder);
+	return remainder;
+}
+
+bigint bigint::gcd(bigint a, bigint b) {
+	a.is_negate = false;
+	b.is_negate = false;
+	while (!b.is_zero()) {
+		if (a.fits_uint64() && b.fits_uint64()) { //finish on machine words
+			uint64_t x = a.magnitude_uint64();
+			uint64_t y = b.magnitude_uint64();
+			while (y != 0) {
+				uint64_t t = x % y;
+				x = y;
+				y = t;
+			}
+			return bigint(x);
+		}
+
+		bigint remainder = a % b;
+		a = std::move(b);
+		b = std::move(remainder);
+		b.is_negate = false;
+	}
+	return a;
+}
+
+std::string bigint::to_string() const {
+	if (limbs.empty()) {
+		return "0";
+	}
+
+	//peel off 9 decimal digits at a time
+	std::string s;
+	bigint temp(*this);
+	while (!temp.is_zero()) {
+		uint32_t chunk = temp.divide_word(1000000000u);
+		for (int i = 0; i < 9; i++) {
+			s.push_back('0' + (chunk % 10));
+			chunk /= 10;
+			if (temp.is_zero() && chunk == 0) {
+				break;
+			}
+		}
+	}
+	if (is_negate) {
+		s.push_back('-');
+	}
+	std::reverse(s.begin(), s.end());
+	return s;
+}
+
+double bigint::to_double() const noexcept {
+	size_t shift;
+	uint64_t top = leading_bits(shift); //sets shift, so it has to be called before shift is read
+	double result = std::ldexp(static_cast<double>(top), static_cast<int>(shift));
+	return is_negate ? -result : result;
+}
+
+size_t bigint::compute_hash() const noexcept {
+	size_t hash = static_cast<size_t>(is_negate);
+	for (uint32_t limb : limbs) {
+		hash = HulaScript::Hash::combine(hash, limb);
+	}
+	return hash;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MatrixExplorer {
+	//arbitrary precision signed integer
+	//magnitude is stored as little-endian base 2^32 limbs, with no leading zero limbs (zero has no limbs)
+	class bigint {
+	private:
+		std::vector<uint32_t> limbs;
+		bool is_negate;
+
+		void trim() noexcept {
+			while (!limbs.empty() && limbs.back() == 0) {
+				limbs.pop_back();
+			}
+			if (limbs.empty()) {
+				is_negate = false;
+			}
+		}
+
+		static int compare_magnitude(const bigint& a, const bigint& b) noexcept;
+		static void add_magnitude(const bigint& a, const bigint& b, bigint& dest);
+		static void subtract_magnitude(const bigint& a, const bigint& b, bigint& dest); //requires |a| >= |b|
+
+		//divides the magnitude by a single limb, returning the remainder
+		uint32_t divide_word(uint32_t divisor) noexcept;
+
+	public:
+		bigint() : is_negate(false) { }
+		bigint(uint64_t magnitude, bool is_negate = false) : is_negate(false) {
+			while (magnitude > 0) {
+				limbs.push_back(static_cast<uint32_t>(magnitude));
+				magnitude >>= 32;
+			}
+			this->is_negate = is_negate && !limbs.empty();
+		}
+
+		static bigint from_int(int64_t integer) {
+			return integer < 0 ? bigint(static_cast<uint64_t>(0) - static_cast<uint64_t>(integer), true) : bigint(static_cast<uint64_t>(integer));
+		}
+
+		//parses a string of decimal digits (no sign, no decimal point)
+		static bigint parse(const std::string& digits);
+
+		const bool is_zero() const noexcept {
+			return limbs.empty();
+		}
+
+		const bool is_negative() const noexcept {
+			return is_negate;
+		}
+
+		const bool is_one() const noexcept {
+			return !is_negate && limbs.size() == 1 && limbs[0] == 1;
+		}
+
+		const bool fits_uint64() const noexcept {
+			return limbs.size() <= 2;
+		}
+
+		//bytes allocated for the limbs
+		size_t footprint() const noexcept {
+			return limbs.capacity() * sizeof(uint32_t);
+		}
+
+		//returns the low 64 bits of the magnitude
+		const uint64_t magnitude_uint64() const noexcept {
+			uint64_t result = 0;
+			if (limbs.size() > 0) {
+				result = limbs[0];
+			}
+			if (limbs.size() > 1) {
+				result |= static_cast<uint64_t>(limbs[1]) << 32;
+			}
+			return result;
+		}
+
+		const size_t bit_length() const noexcept;
+
+		//returns the top 64 bits of the magnitude, and sets shift such that magnitude ~= result * 2^shift
+		const uint64_t leading_bits(size_t& shift) const noexcept;
+
+		bigint abs() const {
+			bigint result(*this);
+			result.is_negate = false;
+			return result;
+		}
+
+		bigint operator-() const {
+			bigint result(*this);
+			result.is_negate = !is_negate && !limbs.empty();
+			return result;
+		}
+
+		bigint operator+(const bigint& other) const;
+		bigint operator-(const bigint& other) const;
+		bigint operator*(const bigint& other) const;
+
+		//truncating division, like the builtin integer types
+		bigint operator/(const bigint& other) const;
+		bigint operator%(const bigint& other) const;
+
+		//throws std::invalid_argument on division by zero
+		static void divide(const bigint& dividend, const bigint& divisor, bigint& quotient, bigint& remainder);
+
+		static bigint gcd(bigint a, bigint b);
+
+		//magnitude modulo a single word modulus
+		const uint32_t mod_word(uint32_t modulus) const noexcept;
+
+		static int compare(const bigint& a, const bigint& b) noexcept;
+
+		bool operator==(const bigint& other) const noexcept {
+			return is_negate == other.is_negate && limbs == other.limbs;
+		}
+		bool operator!=(const bigint& other) const noexcept {
+			return !(*this == other);
+		}
+		bool operator<(const bigint& other) const noexcept {
+			return compare(*this, other) < 0;
+		}
+		bool operator>(const bigint& other) const noexcept {
+			return compare(*this, other) > 0;
+		}
+
+		std::string to_string() const;
+		double to_double() const noexcept;
+
+		size_t compute_hash() const noexcept;
+	};
+}
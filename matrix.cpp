@@ -1,9 +1,12 @@
 #include <sstream>
 #include "matrix.h"
+#include "thread_pool.h"
+#include "simd.h"
 
 using namespace MatrixExplorer;
 
-HulaScript::instance::value matrix::get_elem(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::get_elem(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	if (arguments.size() != 2) {
 		std::stringstream ss;
 		ss << "MatrixEplorer: Matrix get expected a row, and column. Got " << arguments.size() << " argument(s) instead.";
@@ -13,10 +16,11 @@ HulaScript::instance::value matrix::get_elem(std::vector<HulaScript::instance::v
 	int64_t row = arguments[0].index(1, rows + 1, instance) - 1;
 	int64_t col = arguments[1].index(1, cols + 1, instance) - 1;
 
-	return instance.add_foreign_object(std::make_unique<mat_number_type>(mat_number_type(elems[row * cols + col])));
+	return traits::wrap(at(row, col), instance);
 }
 
-HulaScript::instance::value matrix::set_elem(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::set_elem(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	if (arguments.size() != 3) {
 		std::stringstream ss;
 		ss << "MatrixEplorer: Matrix set expected a row, column, and element. Got " << arguments.size() << " argument(s) instead.";
@@ -26,24 +30,59 @@ HulaScript::instance::value matrix::set_elem(std::vector<HulaScript::instance::v
 	int64_t row = arguments[0].index(1, rows + 1, instance) - 1;
 	int64_t col = arguments[1].index(1, cols + 1, instance) - 1;
 
-	elems[row * cols + col] = mat_number_type::unwrap(arguments[2], instance);
+	own_elems()[row * cols + col] = traits::unwrap(arguments[2], instance);
 
 	return HulaScript::instance::value(arguments[2]);
 }
 
-HulaScript::instance::value matrix::transpose(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
-	std::vector<elem_type> new_elems(rows * cols);
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::transpose(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+	//swapping the strides transposes without touching an element
+	return instance.add_foreign_object(std::make_unique<basic_matrix>(slice(cols, rows, offset, col_stride, row_stride)));
+}
 
-	for (size_t i = 0; i < rows; i++) {
-		for (size_t j = 0; j < cols; j++) {
-			new_elems[j * rows + i] = elems[i * cols + j];
-		}
+template<typename number_type>
+void basic_matrix<number_type>::materialize() const {
+	std::shared_ptr<elem_type[]> dense(new elem_type[rows * cols]);
+
+	if (row_stride == 1 && rows > 1) {
+		//a transposed layout: each chunk is a band of transpose_tile rows, copied tile by tile so reads and writes both stay cache resident
+		const elem_type* src = buffer.get() + offset;
+		thread_pool::global().parallel_for(0, cols, transpose_tile, [&](size_t lo, size_t hi) {
+			for (size_t ii = 0; ii < rows; ii += transpose_tile) {
+				size_t i_end = std::min(ii + transpose_tile, rows);
+				if constexpr (std::is_same_v<elem_type, double>) {
+					simd::active().transpose(&src[lo * col_stride + ii], col_stride, &dense[ii * cols + lo], cols, hi - lo, i_end - ii);
+					continue;
+				}
+
+				for (size_t j = lo; j < hi; j++) {
+					for (size_t i = ii; i < i_end; i++) {
+						dense[i * cols + j] = src[j * col_stride + i];
+					}
+				}
+			}
+		});
+	}
+	else {
+		thread_pool::global().parallel_for(0, rows, thread_pool::grain_for(cols), [&](size_t lo, size_t hi) {
+			for (size_t i = lo; i < hi; i++) {
+				for (size_t j = 0; j < cols; j++) {
+					dense[i * cols + j] = at(i, j);
+				}
+			}
+		});
 	}
 
-	return instance.add_foreign_object(std::make_unique<matrix>(cols, rows, new_elems));
+	buffer = std::move(dense);
+	buffer_elems = rows * cols;
+	offset = 0;
+	row_stride = cols;
+	col_stride = 1;
 }
 
-HulaScript::instance::value MatrixExplorer::matrix::augment(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance)
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::augment(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance)
 {
 	if (arguments.size() != 1) {
 		std::stringstream ss;
@@ -51,7 +90,7 @@ HulaScript::instance::value MatrixExplorer::matrix::augment(std::vector<HulaScri
 		instance.panic(ss.str());
 	}
 
-	matrix* mat_operand = dynamic_cast<matrix*>(arguments[0].foreign_obj(instance));
+	basic_matrix* mat_operand = basic_matrix::from_value(arguments[0], instance);
 	if (mat_operand == NULL) {
 		instance.panic("MatrixEplorer: You can only augment a matrix with another matrix.");
 		return HulaScript::instance::value();
@@ -63,31 +102,36 @@ HulaScript::instance::value MatrixExplorer::matrix::augment(std::vector<HulaScri
 		instance.panic(ss.str());
 	}
 
-	std::vector<elem_type> new_elems;
 	size_t new_cols = cols + mat_operand->cols;
-	new_elems.reserve(rows * new_cols);
+	std::vector<elem_type> new_elems(rows * new_cols);
 
-	for (size_t i = 0; i < rows; i++)
-	{
-		for (size_t j = 0; j < cols; j++) {
-			new_elems.push_back(elems[i * cols + j]);
-		}
-		for (size_t j = 0; j < mat_operand->cols; j++) {
-			new_elems.push_back(mat_operand->elems[i * mat_operand->cols + j]);
+	const elem_type* elems = dense_elems();
+	const elem_type* operand_elems = mat_operand->dense_elems();
+
+	thread_pool::global().parallel_for(0, rows, thread_pool::grain_for(new_cols), [&](size_t lo, size_t hi) {
+		for (size_t i = lo; i < hi; i++)
+		{
+			for (size_t j = 0; j < cols; j++) {
+				new_elems[i * new_cols + j] = elems[i * cols + j];
+			}
+			for (size_t j = 0; j < mat_operand->cols; j++) {
+				new_elems[i * new_cols + cols + j] = operand_elems[i * mat_operand->cols + j];
+			}
 		}
-	}
+	});
 
-	return instance.add_foreign_object(std::make_unique<matrix>(rows, new_cols, new_elems));
+	return instance.add_foreign_object(std::make_unique<basic_matrix>(rows, new_cols, new_elems));
 }
 
-HulaScript::instance::value MatrixExplorer::matrix::is_row_equivalent(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::is_row_equivalent(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	if (arguments.size() != 1) {
 		std::stringstream ss;
 		ss << "Matrix Explorer: Matrix isRowEquiv expects a matrix, got " << arguments.size() << " argument(s) instead.";
 		instance.panic(ss.str());
 	}
 
-	matrix* mat_operand = dynamic_cast<matrix*>(arguments[0].foreign_obj(instance));
+	basic_matrix* mat_operand = basic_matrix::from_value(arguments[0], instance);
 	if (mat_operand == NULL) {
 		instance.panic("MatrixEplorer: You can only determine row equivalence of a matrix with another matrix.");
 		return HulaScript::instance::value();
@@ -96,7 +140,19 @@ HulaScript::instance::value MatrixExplorer::matrix::is_row_equivalent(std::vecto
 	return is_row_equivalent(*mat_operand);
 }
 
-HulaScript::instance::value MatrixExplorer::matrix::get_row_vec(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::get_determinant(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+	if (rows != cols) {
+		std::stringstream ss;
+		ss << "Matrix Explorer: Matrix det expects a square matrix, but got a " << rows << "x" << cols << " matrix instead.";
+		instance.panic(ss.str());
+	}
+
+	return traits::wrap(determinant(), instance);
+}
+
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::get_row_vec(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	if (arguments.size() != 1) {
 		std::stringstream ss;
 		ss << "Matrix Explorer: Matrix rowAt expects a row index, got " << arguments.size() << " argument(s) instead.";
@@ -104,10 +160,11 @@ HulaScript::instance::value MatrixExplorer::matrix::get_row_vec(std::vector<Hula
 	}
 
 	size_t index = arguments[0].index(1, rows + 1, instance);
-	return instance.add_foreign_object(std::make_unique<matrix>(get_row_vec(index - 1)));
+	return instance.add_foreign_object(std::make_unique<basic_matrix>(get_row_vec(index - 1)));
 }
 
-HulaScript::instance::value MatrixExplorer::matrix::get_col_vec(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::get_col_vec(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	if (arguments.size() != 1) {
 		std::stringstream ss;
 		ss << "Matrix Explorer: Matrix colAt expects a col index, got " << arguments.size() << " argument(s) instead.";
@@ -115,76 +172,58 @@ HulaScript::instance::value MatrixExplorer::matrix::get_col_vec(std::vector<Hula
 	}
 
 	size_t index = arguments[0].index(1, cols + 1, instance);
-	return instance.add_foreign_object(std::make_unique<matrix>(get_col_vec(index - 1)));
+	return instance.add_foreign_object(std::make_unique<basic_matrix>(get_col_vec(index - 1)));
 }
 
-HulaScript::instance::value MatrixExplorer::matrix::get_rows(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::get_rows(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	auto row_vecs = get_rows();
 	
 	std::vector<HulaScript::instance::value> elems;
 	elems.reserve(row_vecs.size());
 
 	for (auto& row_vec : row_vecs) {
-		elems.push_back(instance.add_foreign_object(std::make_unique<matrix>(std::move(row_vec))));
+		elems.push_back(instance.add_foreign_object(std::make_unique<basic_matrix>(std::move(row_vec))));
 	}
 
 	return instance.make_array(elems);
 }
 
-HulaScript::instance::value MatrixExplorer::matrix::get_cols(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::get_cols(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	auto col_vecs = get_cols();
 
 	std::vector<HulaScript::instance::value> elems;
 	elems.reserve(col_vecs.size());
 
 	for (auto& row_vec : col_vecs) {
-		elems.push_back(instance.add_foreign_object(std::make_unique<matrix>(std::move(row_vec))));
+		elems.push_back(instance.add_foreign_object(std::make_unique<basic_matrix>(std::move(row_vec))));
 	}
 
 	return instance.make_array(elems);
 }
 
-HulaScript::instance::value MatrixExplorer::matrix::get_coefficient_matrix(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
-	std::vector<elem_type> toret_elems;
-	toret_elems.reserve(rows * (cols - 1));
-
-	for (size_t i = 0; i < rows; i++) {
-		for (size_t j = 0; j < cols - 1; j++) {
-			toret_elems.push_back(elems[i * cols + j]);
-		}
-	}
-
-	return instance.add_foreign_object(std::make_unique<matrix>(matrix(rows, cols - 1, toret_elems)));
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::get_coefficient_matrix(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+	return instance.add_foreign_object(std::make_unique<basic_matrix>(view(0, 0, rows, cols - 1)));
 }
 
-HulaScript::instance::value MatrixExplorer::matrix::get_solution_column(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
-	std::vector<elem_type> toret_elems;
-	toret_elems.reserve(rows);
-
-	for (size_t i = 0; i < rows; i++) {
-		toret_elems.push_back(elems[i * cols + (cols - 1)]);
-	}
-
-	return instance.add_foreign_object(std::make_unique<matrix>(matrix(rows, 1, toret_elems)));
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::get_solution_column(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+	return instance.add_foreign_object(std::make_unique<basic_matrix>(view(0, cols - 1, rows, 1)));
 }
 
-HulaScript::instance::value MatrixExplorer::matrix::get_left_square(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::get_left_square(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	if (cols < rows) {
 		instance.panic("Cannot get the left square if the matrix has fewer columns than rows (left square side length is equal to row count).");
 	}
 
-	std::vector<elem_type> toret_elems;
-	toret_elems.reserve(rows * rows);
-	for (size_t i = 0; i < rows; i++) {
-		for (size_t j = rows; j < cols; j++) {
-			toret_elems.push_back(elems[i * cols + j]);
-		}
-	}
-
-	return instance.add_foreign_object(std::make_unique<matrix>(matrix(rows, rows, toret_elems)));
+	return instance.add_foreign_object(std::make_unique<basic_matrix>(view(0, cols - rows, rows, rows)));
 }
 
-HulaScript::instance::value MatrixExplorer::matrix::get_dimensions(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::get_dimensions(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	std::vector<std::pair<std::string, HulaScript::instance::value>> elems;
 	elems.reserve(2);
 
@@ -194,7 +233,8 @@ HulaScript::instance::value MatrixExplorer::matrix::get_dimensions(std::vector<H
 	return instance.make_table_obj(elems, true);
 }
 
-HulaScript::instance::value MatrixExplorer::matrix::get_sub_matrix(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::get_sub_matrix(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	if (arguments.size() != 4) {
 		std::stringstream ss;
 		ss << "Matrix Explorer: Matrix subMat expects a row index, col index, row size, and col size, got " << arguments.size() << " argument(s) instead.";
@@ -206,18 +246,12 @@ HulaScript::instance::value MatrixExplorer::matrix::get_sub_matrix(std::vector<H
 	size_t row_size = arguments[2].index(0, (rows - row_index) + 1, instance);
 	size_t col_size = arguments[3].index(0, (cols - col_index) + 1, instance);
 
-	std::vector<elem_type> elems;
-	for (size_t i = 0; i < row_size; i++) {
-		for (size_t j = 0; j < col_size; j++) {
-			elems.push_back(this->elems[(row_index + i) * cols + (col_index + j)]);
-		}
-	}
-
-	return instance.add_foreign_object(std::make_unique<matrix>(matrix(row_size, col_size, elems)));
+	return instance.add_foreign_object(std::make_unique<basic_matrix>(view(row_index, col_index, row_size, col_size)));
 }
 
-HulaScript::instance::value matrix::add_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) {
-	matrix* mat_operand = dynamic_cast<matrix*>(operand.foreign_obj(instance));
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::add_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) {
+	basic_matrix* mat_operand = basic_matrix::from_value(operand, instance);
 	if (mat_operand == NULL) {
 		instance.panic("MatrixEplorer: You can only add a matrix with another matrix.");
 		return HulaScript::instance::value();
@@ -228,18 +262,27 @@ HulaScript::instance::value matrix::add_operator(HulaScript::instance::value& op
 		return HulaScript::instance::value();
 	}
 
-	std::vector<elem_type> new_elems;
-	new_elems.reserve(rows * cols);
+	std::vector<elem_type> new_elems(rows * cols);
 
-	for (size_t i = 0; i < rows * cols; i++) {
-		new_elems.push_back(elems[i] + mat_operand->elems[i]);
-	}
+	const elem_type* elems = dense_elems();
+	const elem_type* operand_elems = mat_operand->dense_elems();
+	thread_pool::global().parallel_for(0, rows * cols, thread_pool::min_chunk_work, [&](size_t lo, size_t hi) {
+		if constexpr (std::is_same_v<elem_type, double>) {
+			simd::active().add(&elems[lo], &operand_elems[lo], &new_elems[lo], hi - lo);
+			return;
+		}
 
-	return instance.add_foreign_object(std::make_unique<matrix>(matrix(rows, cols, new_elems)));
+		for (size_t i = lo; i < hi; i++) {
+			new_elems[i] = elems[i] + operand_elems[i];
+		}
+	});
+
+	return instance.add_foreign_object(std::make_unique<basic_matrix>(basic_matrix(rows, cols, new_elems)));
 }
 
-HulaScript::instance::value matrix::subtract_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) {
-	matrix* mat_operand = dynamic_cast<matrix*>(operand.foreign_obj(instance));
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::subtract_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) {
+	basic_matrix* mat_operand = basic_matrix::from_value(operand, instance);
 	if (mat_operand == NULL) {
 		instance.panic("MatrixEplorer: You can only subtract a matrix with another matrix.");
 		return HulaScript::instance::value();
@@ -250,18 +293,27 @@ HulaScript::instance::value matrix::subtract_operator(HulaScript::instance::valu
 		return HulaScript::instance::value();
 	}
 
-	std::vector<elem_type> new_elems;
-	new_elems.reserve(rows * cols);
+	std::vector<elem_type> new_elems(rows * cols);
 
-	for (size_t i = 0; i < rows * cols; i++) {
-		new_elems.push_back(elems[i] - mat_operand->elems[i]);
-	}
+	const elem_type* elems = dense_elems();
+	const elem_type* operand_elems = mat_operand->dense_elems();
+	thread_pool::global().parallel_for(0, rows * cols, thread_pool::min_chunk_work, [&](size_t lo, size_t hi) {
+		if constexpr (std::is_same_v<elem_type, double>) {
+			simd::active().subtract(&elems[lo], &operand_elems[lo], &new_elems[lo], hi - lo);
+			return;
+		}
+
+		for (size_t i = lo; i < hi; i++) {
+			new_elems[i] = elems[i] - operand_elems[i];
+		}
+	});
 
-	return instance.add_foreign_object(std::make_unique<matrix>(matrix(rows, cols, new_elems)));
+	return instance.add_foreign_object(std::make_unique<basic_matrix>(basic_matrix(rows, cols, new_elems)));
 }
 
-HulaScript::instance::value matrix::multiply_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) {
-	matrix* mat_operand = dynamic_cast<matrix*>(operand.foreign_obj(instance));
+template<typename number_type>
+HulaScript::instance::value basic_matrix<number_type>::multiply_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) {
+	basic_matrix* mat_operand = basic_matrix::from_value(operand, instance);
 	if (mat_operand == NULL) {
 		instance.panic("MatrixEplorer: You can only multiply a matrix with another matrix.");
 		return HulaScript::instance::value();
@@ -271,52 +323,75 @@ HulaScript::instance::value matrix::multiply_operator(HulaScript::instance::valu
 		instance.panic("MatrixEplorer: You can only multiply a matrix with another matrix where the columns and rows are equal, respectivley.");
 	}
 
-	std::vector<elem_type> new_elems;
-	new_elems.reserve(rows * mat_operand->cols);
-	
+	if constexpr (std::is_same_v<elem_type, rational>) {
+		if (rows * cols * mat_operand->cols >= blocked_multiply_threshold) {
+			return instance.add_foreign_object(std::make_unique<basic_matrix>(blocked_multiply(*mat_operand)));
+		}
+	}
+
+	std::vector<elem_type> new_elems(rows * mat_operand->cols);
+
+	const elem_type* elems = dense_elems();
+	const elem_type* operand_elems = mat_operand->dense_elems();
 	size_t common = cols;
-	for (size_t i = 0; i < rows; i++) {
-		for (size_t j = 0; j < mat_operand->cols; j++)
-		{
-			//result i,j = row i of this dot cols j of operand
-			elem_type sum = rational(0);
-			for (size_t k = 0; k < common; k++)
+	thread_pool::global().parallel_for(0, rows, thread_pool::grain_for(common * mat_operand->cols), [&](size_t lo, size_t hi) {
+		if constexpr (std::is_same_v<elem_type, double>) {
+			//i-k-j order streams contiguous operand rows through the vector kernel; each element still sums over k in order
+			for (size_t i = lo; i < hi; i++) {
+				double* dest_row = &new_elems[i * mat_operand->cols];
+				for (size_t k = 0; k < common; k++) {
+					simd::active().multiply_add(dest_row, &operand_elems[k * mat_operand->cols], elems[i * cols + k], mat_operand->cols);
+				}
+			}
+			return;
+		}
+
+		for (size_t i = lo; i < hi; i++) {
+			for (size_t j = 0; j < mat_operand->cols; j++)
 			{
-				sum = sum + elems[i * cols + k] * mat_operand->elems[j + k * mat_operand->cols];
+				//result i,j = row i of this dot cols j of operand
+				elem_type sum = elem_type(0);
+				for (size_t k = 0; k < common; k++)
+				{
+					sum = sum + elems[i * cols + k] * operand_elems[j + k * mat_operand->cols];
+				}
+				new_elems[i * mat_operand->cols + j] = sum;
 			}
-			new_elems.push_back(sum);
 		}
-	}
+	});
 
-	return instance.add_foreign_object(std::make_unique<matrix>(matrix(rows, mat_operand->cols, new_elems)));
+	return instance.add_foreign_object(std::make_unique<basic_matrix>(basic_matrix(rows, mat_operand->cols, new_elems)));
 }
 
-HulaScript::instance::value MatrixExplorer::make_matrix(std::vector<HulaScript::instance::value> arguments, HulaScript::instance& instance)
+template<typename number_type>
+HulaScript::instance::value MatrixExplorer::make_matrix(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance)
 {
-	if (arguments.size() == 3 && !arguments[0].check_type(HulaScript::instance::value::FOREIGN_OBJECT)) {
+	if (arguments.size() == 3 && !arguments[2].check_type(HulaScript::instance::value::FOREIGN_OBJECT) && !arguments[2].check_type(HulaScript::instance::value::RATIONAL)) { //numeric literals are rationals or foreign objects, so check for the generator instead
 		size_t rows = arguments[0].index(0, INT64_MAX, instance);
 		size_t cols = arguments[1].index(0, INT64_MAX, instance);
+		HulaScript::instance::value generator = arguments[2]; //calling back into the instance invalidates arguments
 		
-		std::vector<matrix::elem_type> elems;
+		std::vector<number_type> elems;
 		elems.reserve(rows * cols);
 
 		for (size_t i = 1; i <= rows; i++) {
 			for (size_t j = 1; j <= cols; j++) {
-				elems.push_back(matrix::mat_number_type::unwrap(instance.invoke_value(arguments[2], {
+				elems.push_back(elem_traits<number_type>::unwrap(instance.invoke_value(generator, {
 					HulaScript::instance::value(static_cast<double>(i)),
 					HulaScript::instance::value(static_cast<double>(j))
 				}), instance));
 			}
 		}
 
-		return instance.add_foreign_object(std::make_unique<matrix>(matrix(rows, cols, elems)));
+		return instance.add_foreign_object(std::make_unique<basic_matrix<number_type>>(basic_matrix<number_type>(rows, cols, elems)));
 	}
 
-	std::vector<matrix::elem_type> elems;
+	//the column vectors come from vec, so they are rational and get converted
+	std::vector<number_type> elems;
 	std::optional<size_t> common_vec_dim = std::nullopt;
 
 	for (auto& arg : arguments) {
-		matrix* arg_mat = dynamic_cast<matrix*>(arg.foreign_obj(instance));
+		matrix* arg_mat = matrix::from_value(arg, instance);
 		if (arg_mat == NULL) {
 			instance.panic("Matrix Explorer: Expected argument(s) to all be matricies.");
 			return HulaScript::instance::value();
@@ -340,22 +415,34 @@ HulaScript::instance::value MatrixExplorer::make_matrix(std::vector<HulaScript::
 			common_vec_dim = dim.first;
 		}
 
-		elems.insert(elems.end(), arg_mat->elements(), arg_mat->elements() + (dim.second * dim.first));
+		if constexpr (std::is_same_v<number_type, rational>) {
+			elems.insert(elems.end(), arg_mat->elements(), arg_mat->elements() + (dim.second * dim.first));
+		}
+		else {
+			for (size_t i = 0; i < dim.second * dim.first; i++) {
+				try {
+					elems.push_back(elem_traits<number_type>::from_rational(arg_mat->elements()[i]));
+				}
+				catch (const std::invalid_argument& error) {
+					instance.panic(std::string("Matrix Explorer: ") + error.what());
+				}
+			}
+		}
 	}
 
 	size_t rows = common_vec_dim.has_value() ? common_vec_dim.value() : 0;
 	
-	std::vector<matrix::elem_type> new_elems(elems.size());
+	std::vector<number_type> new_elems(elems.size());
 	for (size_t i = 0; i < arguments.size(); i++) {
 		for (size_t j = 0; j < rows; j++) {
 			new_elems[j * arguments.size() + i] = elems[i * rows + j];
 		}
 	}
 
-	return instance.add_foreign_object(std::make_unique<matrix>(rows, arguments.size(), new_elems));
+	return instance.add_foreign_object(std::make_unique<basic_matrix<number_type>>(rows, arguments.size(), new_elems));
 }
 
-HulaScript::instance::value MatrixExplorer::make_vector(std::vector<HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+HulaScript::instance::value MatrixExplorer::make_vector(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	std::vector<matrix::elem_type> elems;
 	elems.reserve(arguments.size());
 
@@ -366,7 +453,7 @@ HulaScript::instance::value MatrixExplorer::make_vector(std::vector<HulaScript::
 	return instance.add_foreign_object(std::make_unique<matrix>(matrix(elems.size(), 1, elems)));
 }
 
-HulaScript::instance::value MatrixExplorer::make_identity_matrix(std::vector<HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+HulaScript::instance::value MatrixExplorer::make_identity_matrix(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	if (arguments.size() != 1) {
 		std::stringstream ss;
 		ss << "MatrixEplorer: identity expects dimension. Got " << arguments.size() << " argument(s) instead.";
@@ -386,7 +473,7 @@ HulaScript::instance::value MatrixExplorer::make_identity_matrix(std::vector<Hul
 	return instance.add_foreign_object(std::make_unique<matrix>(matrix(dim, dim, elems)));
 }
 
-HulaScript::instance::value MatrixExplorer::make_zero_matrix(std::vector<HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+HulaScript::instance::value MatrixExplorer::make_zero_matrix(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 	if (arguments.size() != 2) {
 		std::stringstream ss;
 		ss << "MatrixEplorer: Matrix get expected a row, and column. Got " << arguments.size() << " argument(s) instead.";
@@ -399,3 +486,12 @@ HulaScript::instance::value MatrixExplorer::make_zero_matrix(std::vector<HulaScr
 	std::vector<matrix::elem_type> elems(rows * cols, 0);
 	return instance.add_foreign_object(std::make_unique<matrix>(matrix(rows, cols, elems)));
 }
+
+
+template class MatrixExplorer::basic_matrix<rational>;
+template class MatrixExplorer::basic_matrix<double>;
+template class MatrixExplorer::basic_matrix<prime_field>;
+
+template HulaScript::instance::value MatrixExplorer::make_matrix<rational>(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+template HulaScript::instance::value MatrixExplorer::make_matrix<double>(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+template HulaScript::instance::value MatrixExplorer::make_matrix<prime_field>(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
\ No newline at end of file
@@ -1,109 +1,311 @@
 #pragma once
 
 #include <cassert>
-#include <cstring>
+#include <algorithm>
+#include <optional>
+#include <sstream>
+#include <type_traits>
 #include <vector>
 #include "ffi.h"
 #include "hash.h"
 #include "rational.h"
+#include "prime_field.h"
 
 namespace MatrixExplorer {
-	class matrix : public HulaScript::foreign_method_object<matrix> {
-	public:
-		using elem_type = rational;
+	class mat_number_type : public HulaScript::instance::foreign_object {
+	private:
+		rational number_;
 
-		class mat_number_type : public HulaScript::instance::foreign_object {
-		private:
-			rational number_;
+	public:
+		mat_number_type(rational number) : number_(number) { }
+
+		//precise numbers that fit are stored inline by the vm, so scalar arithmetic in scripts doesn't allocate
+		static HulaScript::instance::value wrap(const rational& number, HulaScript::instance& instance) {
+			int64_t numerator;
+			uint64_t denominator;
+			if (number.to_fraction(numerator, denominator)) {
+				return instance.make_rational(numerator, denominator);
+			}
+			return instance.add_foreign_object(std::make_unique<mat_number_type>(mat_number_type(number)));
+		}
 
-		public:
-			mat_number_type(rational number) : number_(number) { }
+		//the vm's rational spiller, for fractions too wide to store inline
+		static HulaScript::instance::value spill(int64_t numerator, uint64_t denominator, HulaScript::instance& instance) {
+			return instance.add_foreign_object(std::make_unique<mat_number_type>(mat_number_type(rational::from_fraction(numerator, denominator))));
+		}
 
-			static elem_type unwrap(HulaScript::instance::value value, HulaScript::instance& instance) {
-				mat_number_type* obj = dynamic_cast<mat_number_type*>(value.foreign_obj(instance));
-				if (obj == NULL) {
-					instance.panic("MatrixExplorer: Expected precise number, got something else.");
-					return rational(0);
-				}
-				return obj->number_;
+		static rational unwrap(HulaScript::instance::value value, HulaScript::instance& instance) {
+			if (value.check_type(HulaScript::instance::value::vtype::RATIONAL)) {
+				auto fraction = value.rational(instance);
+				return rational::from_fraction(fraction.first, fraction.second);
 			}
 
-		protected:
-			HulaScript::instance::value add_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) override{
-				elem_type b = unwrap(operand, instance);
-				return instance.add_foreign_object(std::make_unique<mat_number_type>(mat_number_type(number_ + b)));
+			mat_number_type* obj = dynamic_cast<mat_number_type*>(value.foreign_obj(instance));
+			if (obj == NULL) {
+				instance.panic("MatrixExplorer: Expected precise number, got something else.");
+				return rational(0);
 			}
+			return obj->number_;
+		}
 
-			HulaScript::instance::value subtract_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) override {
-				elem_type b = unwrap(operand, instance);
-				return instance.add_foreign_object(std::make_unique<mat_number_type>(mat_number_type(number_ - b)));
-			}
+	protected:
+		HulaScript::instance::value add_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) override{
+			rational b = unwrap(operand, instance);
+			return wrap(number_ + b, instance);
+		}
+
+		HulaScript::instance::value subtract_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) override {
+			rational b = unwrap(operand, instance);
+			return wrap(number_ - b, instance);
+		}
+
+		HulaScript::instance::value multiply_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) override {
+			rational b = unwrap(operand, instance);
+			return wrap(number_ * b, instance);
+		}
+
+		HulaScript::instance::value divide_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) override {
+			rational b = unwrap(operand, instance);
+			return wrap(number_ / b, instance);
+		}
+
+	public:
+		size_t compute_hash() override {
+			//forgive me for this hash
+			return number_.compute_hash();
+		}
+
+		std::string to_string() override {
+			return number_.to_string();
+		}
+
+		double to_number() override {
+			return number_.to_double();
+		}
+
+		size_t memory_footprint() override {
+			return sizeof(mat_number_type) + number_.footprint();
+		}
+	};
 
-			HulaScript::instance::value multiply_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) override {
-				elem_type b = unwrap(operand, instance);
-				return instance.add_foreign_object(std::make_unique<mat_number_type>(mat_number_type(number_ * b)));
+	//per element type operations the matrix kernels and script bindings need, beyond arithmetic
+	//conversions between element types all go through rational, which can represent every value exactly
+	template<typename number_type>
+	struct elem_traits;
+
+	template<>
+	struct elem_traits<rational> {
+		static bool is_zero(const rational& elem) noexcept { return elem.is_zero(); }
+		static std::string to_string(const rational& elem) { return elem.to_string(); }
+		static size_t footprint(const rational& elem) noexcept { return elem.footprint(); }
+
+		static rational from_rational(const rational& number) { return number; }
+		static rational to_rational(const rational& elem) { return elem; }
+
+		static HulaScript::instance::value wrap(const rational& elem, HulaScript::instance& instance) {
+			return mat_number_type::wrap(elem, instance);
+		}
+		static rational unwrap(HulaScript::instance::value value, HulaScript::instance& instance) {
+			return mat_number_type::unwrap(value, instance);
+		}
+	};
+
+	template<>
+	struct elem_traits<double> {
+		static bool is_zero(double elem) noexcept { return elem == 0; }
+		static size_t footprint(double) noexcept { return 0; }
+		static std::string to_string(double elem) {
+			std::stringstream ss;
+			ss << elem;
+			return ss.str();
+		}
+
+		static double from_rational(const rational& number) { return number.to_double(); }
+		static rational to_rational(double elem) { return rational::from_double(elem); }
+
+		static HulaScript::instance::value wrap(double elem, HulaScript::instance& instance) {
+			return HulaScript::instance::value(elem);
+		}
+		static double unwrap(HulaScript::instance::value value, HulaScript::instance& instance) {
+			return value.number(instance);
+		}
+	};
+
+	template<>
+	struct elem_traits<prime_field> {
+		static bool is_zero(const prime_field& elem) noexcept { return elem.is_zero(); }
+		static std::string to_string(const prime_field& elem) { return elem.to_string(); }
+		static size_t footprint(const prime_field&) noexcept { return 0; }
+
+		static prime_field from_rational(const rational& number) { return prime_field::from_rational(number); }
+		static rational to_rational(const prime_field& elem) { return rational(elem.residue()); }
+
+		static HulaScript::instance::value wrap(const prime_field& elem, HulaScript::instance& instance) {
+			return mat_number_type::wrap(to_rational(elem), instance);
+		}
+		static prime_field unwrap(HulaScript::instance::value value, HulaScript::instance& instance) {
+			if (!value.check_type(HulaScript::instance::value::vtype::FOREIGN_OBJECT) && !value.check_type(HulaScript::instance::value::vtype::RATIONAL)) {
+				double number = value.number(instance);
+				if (number != static_cast<double>(static_cast<int64_t>(number))) {
+					std::stringstream ss;
+					ss << "Matrix Explorer: Expected an integer or precise number for a prime field element, got " << number << " instead.";
+					instance.panic(ss.str());
+				}
+				return prime_field::from_int(static_cast<int64_t>(number));
 			}
 
-			HulaScript::instance::value divide_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) override {
-				elem_type b = unwrap(operand, instance);
-				return instance.add_foreign_object(std::make_unique<mat_number_type>(mat_number_type(number_ / b)));
+			rational number = mat_number_type::unwrap(value, instance);
+			try {
+				return prime_field::from_rational(number);
+			}
+			catch (const std::invalid_argument& error) {
+				instance.panic(std::string("Matrix Explorer: ") + error.what());
+				return prime_field();
 			}
+		}
+	};
+
+	template<typename number_type>
+	class basic_matrix : public HulaScript::foreign_method_object<basic_matrix<number_type>> {
+	public:
+		using elem_type = number_type;
+		using traits = elem_traits<number_type>;
+		using mat_number_type = MatrixExplorer::mat_number_type;
 
-		public:
-			size_t compute_hash() override {
-				//forgive me for this hash
-				return number_.compute_hash();
+	private:
+		size_t rows, cols;
+
+		//Elements live in a buffer that slices of this matrix (and whatever it was sliced from) may share, with element
+		//(i, j) at buffer[offset + i * row_stride + j * col_stride]. Readers wanting plain row-major storage go through
+		//dense_elems() and writers through own_elems(); both copy out a private row-major buffer first when the layout is
+		//strided, and writers also when the buffer is shared, so slicing is O(1) and mutation is copy-on-write.
+		mutable std::shared_ptr<elem_type[]> buffer;
+		mutable size_t buffer_elems; //the whole buffer's, which a slice may cover only part of
+		mutable size_t offset, row_stride, col_stride;
+
+		//what buffer_bytes last counted, and for which buffer; writers go through own_elems(), which clears it
+		mutable const elem_type* counted_buffer = NULL;
+		mutable size_t counted_bytes = 0;
+
+		basic_matrix(size_t rows, size_t cols, std::shared_ptr<elem_type[]> buffer, size_t buffer_elems, size_t offset, size_t row_stride, size_t col_stride) : rows(rows), cols(cols), buffer(std::move(buffer)), buffer_elems(buffer_elems), offset(offset), row_stride(row_stride), col_stride(col_stride) { }
+
+		//a matrix sharing this one's buffer, and the count of its bytes, so slices never walk the elements
+		basic_matrix slice(size_t slice_rows, size_t slice_cols, size_t slice_offset, size_t slice_row_stride, size_t slice_col_stride) const {
+			basic_matrix sliced(slice_rows, slice_cols, buffer, buffer_elems, slice_offset, slice_row_stride, slice_col_stride);
+			sliced.counted_bytes = buffer_bytes();
+			sliced.counted_buffer = counted_buffer;
+			return sliced;
+		}
+
+		//the view_rows x view_cols block starting at (row_index, col_index), sharing this matrix's buffer
+		basic_matrix view(size_t row_index, size_t col_index, size_t view_rows, size_t view_cols) const {
+			return slice(view_rows, view_cols, offset + row_index * row_stride + col_index * col_stride, row_stride, col_stride);
+		}
+
+		//everything the buffer retains, counted once per buffer
+		size_t buffer_bytes() const noexcept {
+			if (counted_buffer != buffer.get()) {
+				counted_bytes = buffer_elems * sizeof(elem_type);
+				for (size_t i = 0; i < buffer_elems; i++) {
+					counted_bytes += traits::footprint(buffer[i]);
+				}
+				counted_buffer = buffer.get();
 			}
+			return counted_bytes;
+		}
 
-			std::string to_string() override {
-				return number_.to_string();
+		bool is_dense() const noexcept {
+			return (rows <= 1 || row_stride == cols) && (cols <= 1 || col_stride == 1);
+		}
+
+		//replaces the buffer with a private row-major copy of the elements
+		void materialize() const;
+
+		const elem_type* dense_elems() const {
+			if (!is_dense()) {
+				materialize();
 			}
+			return buffer.get() + offset;
+		}
 
-			double to_number() override {
-				return number_.to_double();
+		elem_type* own_elems() {
+			if (!is_dense() || buffer.use_count() > 1) {
+				materialize();
 			}
-		};
+			counted_buffer = NULL;
+			return buffer.get() + offset;
+		}
 
-	private:
-		size_t rows, cols;
-		std::unique_ptr<elem_type[]> elems;
+		const elem_type& at(size_t i, size_t j) const noexcept {
+			return buffer[offset + i * row_stride + j * col_stride];
+		}
+
+		template<typename other_type>
+		friend class basic_matrix;
+
+		using HulaScript::foreign_method_object<basic_matrix>::declare_method;
 
 		HulaScript::instance::value add_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) override;
 		HulaScript::instance::value subtract_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) override;
 		HulaScript::instance::value multiply_operator(HulaScript::instance::value& operand, HulaScript::instance& instance) override;
 
-		HulaScript::instance::value get_elem(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
-		HulaScript::instance::value set_elem(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
-	
-		HulaScript::instance::value transpose(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
-		HulaScript::instance::value augment(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
-		
-		HulaScript::instance::value reduced_echelon_form(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
-			return instance.add_foreign_object(std::make_unique<matrix>(reduce()));
+		HulaScript::instance::value get_elem(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+		HulaScript::instance::value set_elem(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+
+		HulaScript::instance::value transpose(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+		HulaScript::instance::value augment(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+
+		HulaScript::instance::value reduced_echelon_form(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+			return instance.add_foreign_object(std::make_unique<basic_matrix>(reduce()));
 		}
-		HulaScript::instance::value row_reduced_echelon_form(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
-			return instance.add_foreign_object(std::make_unique<matrix>(row_reduce()));
+		HulaScript::instance::value row_reduced_echelon_form(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+			return instance.add_foreign_object(std::make_unique<basic_matrix>(row_reduce()));
 		}
 
-		HulaScript::instance::value is_reduced_echelon_form(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+		HulaScript::instance::value fraction_free_reduced_echelon_form(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) requires std::is_same_v<number_type, rational> {
+			return instance.add_foreign_object(std::make_unique<basic_matrix>(bareiss_reduce()));
+		}
+		HulaScript::instance::value fraction_free_row_reduced_echelon_form(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) requires std::is_same_v<number_type, rational> {
+			return instance.add_foreign_object(std::make_unique<basic_matrix>(bareiss_row_reduce()));
+		}
+		HulaScript::instance::value get_determinant(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+
+		HulaScript::instance::value get_multimodular_determinant(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) requires std::is_same_v<number_type, rational>;
+		HulaScript::instance::value get_rank(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) requires std::is_same_v<number_type, rational> {
+			return HulaScript::instance::value(static_cast<double>(multimodular_rank()));
+		}
+		HulaScript::instance::value solve(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) requires std::is_same_v<number_type, rational>;
+
+		HulaScript::instance::value is_reduced_echelon_form(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 			return HulaScript::instance::value(is_ref());
 		}
-		HulaScript::instance::value is_row_reduced_echelon_form(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance) {
+		HulaScript::instance::value is_row_reduced_echelon_form(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
 			return HulaScript::instance::value(is_rref());
 		}
-		HulaScript::instance::value is_row_equivalent(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
+		HulaScript::instance::value is_row_equivalent(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+
+		HulaScript::instance::value get_row_vec(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+		HulaScript::instance::value get_col_vec(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+		HulaScript::instance::value get_rows(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+		HulaScript::instance::value get_cols(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
 
-		HulaScript::instance::value get_row_vec(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
-		HulaScript::instance::value get_col_vec(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
-		HulaScript::instance::value get_rows(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
-		HulaScript::instance::value get_cols(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
+		HulaScript::instance::value get_coefficient_matrix(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+		HulaScript::instance::value get_solution_column(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+		HulaScript::instance::value get_left_square(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
 
-		HulaScript::instance::value get_coefficient_matrix(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
-		HulaScript::instance::value get_solution_column(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
-		HulaScript::instance::value get_left_square(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
+		HulaScript::instance::value get_dimensions(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+		HulaScript::instance::value get_sub_matrix(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
 
-		HulaScript::instance::value get_dimensions(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
-		HulaScript::instance::value get_sub_matrix(std::vector<HulaScript::instance::value>& arguments, HulaScript::instance& instance);
+		template<typename target_type>
+		HulaScript::instance::value convert_to(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+			try {
+				return instance.add_foreign_object(std::make_unique<basic_matrix<target_type>>(convert<target_type>()));
+			}
+			catch (const std::invalid_argument& error) {
+				instance.panic(std::string("Matrix Explorer: ") + error.what());
+				return HulaScript::instance::value();
+			}
+		}
 
 		//add one to get right elementary matrix
 
@@ -111,62 +313,153 @@ namespace MatrixExplorer {
 		void scale_row(size_t i, elem_type scalar);
 		void add_rows(size_t add_to, size_t how_much);
 		void subtract_rows(size_t subtract_from, size_t how_much, elem_type scale);
-	public:
 
-		matrix(size_t rows, size_t cols, std::vector<elem_type> elems_vec) : rows(rows), cols(cols), elems(new elem_type[elems_vec.size()]) {
-			assert(elems_vec.size() == rows * cols);
-			std::memcpy(elems.get(), elems_vec.data(), elems_vec.size() * sizeof(elem_type));
+		//side length of the square tiles transpose copies through
+		static const size_t transpose_tile = 32;
 
-			declare_method("get", &matrix::get_elem);
-			declare_method("set", &matrix::set_elem);
-			declare_method("trans", &matrix::transpose);
-			declare_method("augment", &matrix::augment);
-			declare_method("subMat", &matrix::get_sub_matrix);
+		//multiplications with at least this many scalar products use blocked_multiply (rational matrices only)
+		static const size_t blocked_multiply_threshold = 16 * 16 * 16;
+		basic_matrix blocked_multiply(const basic_matrix& operand) const noexcept requires std::is_same_v<number_type, rational>;
 
-			declare_method("ref", &matrix::reduced_echelon_form);
-			declare_method("rref", &matrix::row_reduced_echelon_form);
-			declare_method("isRef", &matrix::is_reduced_echelon_form);
-			declare_method("isRref", &matrix::is_row_reduced_echelon_form);
-			declare_method("isRowEquiv", &matrix::is_row_equivalent);
+		//false if ranks modulo random primes show the row spaces differ; true is only probable, see multimodular.cpp
+		bool randomized_row_equivalent(const basic_matrix& other) const noexcept requires std::is_same_v<number_type, rational>;
+	public:
 
-			declare_method("rowAt", &matrix::get_row_vec);
-			declare_method("colAt", &matrix::get_col_vec);
-			declare_method("rows", &matrix::get_rows);
-			declare_method("cols", &matrix::get_cols);
+		basic_matrix(size_t rows, size_t cols, std::vector<elem_type> elems_vec) : rows(rows), cols(cols), buffer(new elem_type[elems_vec.size()]), buffer_elems(elems_vec.size()), offset(0), row_stride(cols), col_stride(1) {
+			assert(elems_vec.size() == rows * cols);
+			std::move(elems_vec.begin(), elems_vec.end(), buffer.get());
+		}
+
+		//NULL unless value is a matrix of this element type; numeric literals are inline rationals rather than foreign objects
+		static basic_matrix* from_value(const HulaScript::instance::value& value, HulaScript::instance& instance) {
+			if (value.check_type(HulaScript::instance::value::vtype::RATIONAL)) {
+				return NULL;
+			}
+			return dynamic_cast<basic_matrix*>(value.foreign_obj(instance));
+		}
 
-			declare_method("dim", &matrix::get_dimensions);
-			declare_method("coef", &matrix::get_coefficient_matrix);
-			declare_method("sol", &matrix::get_solution_column);
-			declare_method("leftSq", &matrix::get_left_square);
+		//run once, to build the method table every matrix of this element type shares
+		static void declare_methods() {
+			declare_method("get", &basic_matrix::get_elem);
+			declare_method("set", &basic_matrix::set_elem);
+			declare_method("trans", &basic_matrix::transpose);
+			declare_method("augment", &basic_matrix::augment);
+			declare_method("subMat", &basic_matrix::get_sub_matrix);
+
+			declare_method("ref", &basic_matrix::reduced_echelon_form);
+			declare_method("rref", &basic_matrix::row_reduced_echelon_form);
+			if constexpr (std::is_same_v<elem_type, rational>) {
+				declare_method("bareissRef", &basic_matrix::fraction_free_reduced_echelon_form);
+				declare_method("bareissRref", &basic_matrix::fraction_free_row_reduced_echelon_form);
+				declare_method("crtDet", &basic_matrix::get_multimodular_determinant);
+				declare_method("rank", &basic_matrix::get_rank);
+				declare_method("solve", &basic_matrix::solve);
+			}
+			declare_method("det", &basic_matrix::get_determinant);
+			declare_method("isRef", &basic_matrix::is_reduced_echelon_form);
+			declare_method("isRref", &basic_matrix::is_row_reduced_echelon_form);
+			declare_method("isRowEquiv", &basic_matrix::is_row_equivalent);
+
+			declare_method("rowAt", &basic_matrix::get_row_vec);
+			declare_method("colAt", &basic_matrix::get_col_vec);
+			declare_method("rows", &basic_matrix::get_rows);
+			declare_method("cols", &basic_matrix::get_cols);
+
+			declare_method("dim", &basic_matrix::get_dimensions);
+			declare_method("coef", &basic_matrix::get_coefficient_matrix);
+			declare_method("sol", &basic_matrix::get_solution_column);
+			declare_method("leftSq", &basic_matrix::get_left_square);
+
+			declare_method("toMat", &basic_matrix::template convert_to<rational>);
+			declare_method("toMatf", &basic_matrix::template convert_to<double>);
+			declare_method("toMatp", &basic_matrix::template convert_to<prime_field>);
 		}
 
 		const std::pair<size_t, size_t> dims() const noexcept {
 			return std::make_pair(rows, cols);
 		}
 
-		const elem_type* elements() const noexcept {
-			return elems.get();
+		const elem_type* elements() const {
+			return dense_elems();
 		}
 
 		std::string to_string() override;
 
-		matrix row_reduce() const noexcept;
-		matrix reduce() const noexcept;
+		//A shared buffer is split evenly between the matrices holding it, so together they're charged for it once. Shares
+		//are as of when the footprint is read; collections re-read them as slices come and go.
+		size_t memory_footprint() override {
+			return sizeof(basic_matrix) + buffer_bytes() / buffer.use_count();
+		}
+
+		basic_matrix row_reduce() const noexcept;
+		basic_matrix reduce() const noexcept;
+
+		//fraction-free (Bareiss) alternatives to reduce/row_reduce, for rational matrices only; see bareiss.cpp
+		basic_matrix bareiss_row_reduce() const noexcept requires std::is_same_v<number_type, rational>;
+		basic_matrix bareiss_reduce() const noexcept requires std::is_same_v<number_type, rational>;
+
+		//rational matrices use Bareiss elimination, the others plain Gaussian elimination
+		elem_type determinant() const noexcept;
+
+		//multi-modular (CRT) alternatives for rational matrices; see multimodular.cpp
+		//all three are exact
+		//solve needs a square, nonsingular matrix and returns nothing when it is singular
+		elem_type multimodular_determinant() const noexcept requires std::is_same_v<number_type, rational>;
+		size_t multimodular_rank() const noexcept requires std::is_same_v<number_type, rational>;
+		std::optional<basic_matrix> multimodular_solve(const basic_matrix& rhs) const noexcept requires std::is_same_v<number_type, rational>;
 
 		bool is_ref() const noexcept;
 		bool is_rref() const noexcept;
 
-		bool is_row_equivalent(const matrix& other) const noexcept;
+		bool is_row_equivalent(const basic_matrix& other) const noexcept;
+
+		basic_matrix get_row_vec(size_t i);
+		basic_matrix get_col_vec(size_t i);
+
+		std::vector<basic_matrix> get_rows();
+		std::vector<basic_matrix> get_cols();
 
-		matrix get_row_vec(size_t i);
-		matrix get_col_vec(size_t i);
+		//converts every element through its exact rational value; throws std::invalid_argument if one has no image
+		template<typename target_type>
+		basic_matrix<target_type> convert() const {
+			const elem_type* elems = dense_elems();
 
-		std::vector<matrix> get_rows();
-		std::vector<matrix> get_cols();
+			std::vector<target_type> new_elems;
+			new_elems.reserve(rows * cols);
+
+			for (size_t i = 0; i < rows * cols; i++) {
+				if constexpr (std::is_same_v<target_type, elem_type>) {
+					new_elems.push_back(elems[i]);
+				}
+				else {
+					new_elems.push_back(elem_traits<target_type>::from_rational(traits::to_rational(elems[i])));
+				}
+			}
+
+			return basic_matrix<target_type>(rows, cols, new_elems);
+		}
 	};
 
-	HulaScript::instance::value make_matrix(std::vector<HulaScript::instance::value> arguments, HulaScript::instance& instance);
-	HulaScript::instance::value make_vector(std::vector<HulaScript::instance::value> arguments, HulaScript::instance& instance);
-	HulaScript::instance::value make_identity_matrix(std::vector<HulaScript::instance::value> arguments, HulaScript::instance& instance);
-	HulaScript::instance::value make_zero_matrix(std::vector<HulaScript::instance::value> arguments, HulaScript::instance& instance);
+	using matrix = basic_matrix<rational>;
+	using float_matrix = basic_matrix<double>;
+	using prime_matrix = basic_matrix<prime_field>;
+
+	template<> matrix matrix::blocked_multiply(const matrix& operand) const noexcept;
+	template<> matrix matrix::bareiss_row_reduce() const noexcept;
+	template<> matrix matrix::bareiss_reduce() const noexcept;
+	template<> rational matrix::determinant() const noexcept;
+	template<> rational matrix::multimodular_determinant() const noexcept;
+	template<> size_t matrix::multimodular_rank() const noexcept;
+	template<> std::optional<matrix> matrix::multimodular_solve(const matrix& rhs) const noexcept;
+	template<> bool matrix::randomized_row_equivalent(const matrix& other) const noexcept;
+	template<> HulaScript::instance::value matrix::get_multimodular_determinant(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+	template<> HulaScript::instance::value matrix::solve(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+
+	//mat, matf and matp construct a matrix of the corresponding element type
+	template<typename number_type>
+	HulaScript::instance::value make_matrix(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+
+	HulaScript::instance::value make_vector(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+	HulaScript::instance::value make_identity_matrix(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
+	HulaScript::instance::value make_zero_matrix(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance);
 }
\ No newline at end of file
@@ -0,0 +1,479 @@
+#include <cmath>
+#include <random>
+#include "matrix.h"
+#include "thread_pool.h"
+
+using namespace MatrixExplorer;
+
+//Multi-modular (CRT) elimination. The matrix is scaled to integers once, each row by the lcm of its denominators (as in
+//bareiss.cpp), then eliminated independently modulo many word size primes, one prime per pool chunk. Residue arithmetic
+//never grows, so the only bigint work left is combining the residues with the Chinese Remainder Theorem at the end.
+//How many primes are needed comes from the Hadamard bound, so every result is exact; only isRowEquiv is randomized.
+
+//every prime is below 2^31, so the product of two residues fits in 64 bits
+static const uint32_t largest_prime_bound = 0x80000000u;
+
+//each prime is above 2^30, so every prime contributes at least this many bits to the CRT modulus
+static const size_t bits_per_prime = 30;
+
+//isRowEquiv compares ranks modulo this many random primes
+static const size_t rank_trials = 2;
+
+static uint32_t multiply_mod(uint32_t a, uint32_t b, uint32_t p) noexcept {
+	return static_cast<uint32_t>(static_cast<uint64_t>(a) * b % p);
+}
+
+static uint32_t power_mod(uint32_t base, uint32_t exponent, uint32_t p) noexcept {
+	uint32_t result = 1;
+	while (exponent > 0) {
+		if (exponent & 1) {
+			result = multiply_mod(result, base, p);
+		}
+		base = multiply_mod(base, base, p);
+		exponent >>= 1;
+	}
+	return result;
+}
+
+static uint32_t inverse_mod(uint32_t a, uint32_t p) noexcept {
+	return power_mod(a, p - 2, p); //fermat
+}
+
+//deterministic Miller-Rabin; bases 2, 7 and 61 cover every n below 4759123141
+static bool is_word_prime(uint32_t n) noexcept {
+	if (n < 2 || n % 2 == 0) {
+		return n == 2;
+	}
+
+	uint32_t d = n - 1;
+	size_t s = 0;
+	while (d % 2 == 0) {
+		d /= 2;
+		s++;
+	}
+
+	for (uint32_t base : { 2u, 7u, 61u }) {
+		if (base % n == 0) {
+			continue;
+		}
+
+		uint32_t x = power_mod(base, d, n);
+		if (x == 1 || x == n - 1) {
+			continue;
+		}
+
+		bool composite = true;
+		for (size_t i = 1; i < s && composite; i++) {
+			x = multiply_mod(x, x, n);
+			composite = x != n - 1;
+		}
+		if (composite) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//appends the next count primes below bound, in descending order, and returns the new bound
+static uint32_t next_primes(uint32_t bound, size_t count, std::vector<uint32_t>& primes) {
+	while (count > 0) {
+		bound--;
+		if (is_word_prime(bound)) {
+			primes.push_back(bound);
+			count--;
+		}
+	}
+	return bound;
+}
+
+static uint32_t random_prime(std::mt19937_64& rng) {
+	std::uniform_int_distribution<uint32_t> dist(largest_prime_bound / 2, largest_prime_bound - 1);
+	for (;;) {
+		uint32_t candidate = dist(rng) | 1;
+		if (is_word_prime(candidate)) {
+			return candidate;
+		}
+	}
+}
+
+static uint32_t residue(const bigint& integer, uint32_t p) noexcept {
+	uint32_t r = integer.mod_word(p);
+	return (integer.is_negative() && r != 0) ? p - r : r;
+}
+
+//scales each row of [left | right] to integers by the lcm of its denominators; right may have no columns
+static std::vector<bigint> integer_rows(const rational* left, size_t left_cols, const rational* right, size_t right_cols, size_t rows, std::vector<bigint>* row_scales) {
+	std::vector<bigint> result;
+	result.reserve(rows * (left_cols + right_cols));
+
+	for (size_t i = 0; i < rows; i++) {
+		bigint scale(1);
+		auto widen = [&](const rational& elem) {
+			bigint denom = elem.big_denominator();
+			if (!denom.is_one()) {
+				scale = (scale / bigint::gcd(scale, denom)) * denom;
+			}
+		};
+		for (size_t j = 0; j < left_cols; j++) {
+			widen(left[i * left_cols + j]);
+		}
+		for (size_t j = 0; j < right_cols; j++) {
+			widen(right[i * right_cols + j]);
+		}
+
+		auto push = [&](const rational& elem) {
+			result.push_back(scale.is_one() ? elem.big_numerator() : elem.big_numerator() * (scale / elem.big_denominator()));
+		};
+		for (size_t j = 0; j < left_cols; j++) {
+			push(left[i * left_cols + j]);
+		}
+		for (size_t j = 0; j < right_cols; j++) {
+			push(right[i * right_cols + j]);
+		}
+
+		if (row_scales != NULL) {
+			row_scales->push_back(std::move(scale));
+		}
+	}
+	return result;
+}
+
+//bits in the Hadamard bound on any square minor taking at most width entries from each row; the bound is the product of
+//row norms, and a row norm is at most sqrt(width) times its largest entry
+static size_t hadamard_bits(const std::vector<bigint>& m, size_t rows, size_t cols, size_t width) noexcept {
+	double bits = 0;
+	for (size_t i = 0; i < rows; i++) {
+		size_t row_bits = 0;
+		for (size_t j = 0; j < cols; j++) {
+			row_bits = std::max(row_bits, m[i * cols + j].bit_length());
+		}
+		bits += static_cast<double>(row_bits) + std::log2(static_cast<double>(std::max<size_t>(width, 1))) / 2;
+	}
+	return static_cast<size_t>(std::ceil(bits)) + 1;
+}
+
+static std::vector<uint32_t> residues(const std::vector<bigint>& m, uint32_t p) {
+	std::vector<uint32_t> result;
+	result.reserve(m.size());
+	for (const bigint& elem : m) {
+		result.push_back(residue(elem, p));
+	}
+	return result;
+}
+
+//Gauss-Jordan elimination over Z/p in place, with pivots looked for in the first pivot_cols columns only and scaled to one
+//returns the rank, and sets det to the product of the pivots (with swap signs), which is the determinant when square
+static size_t eliminate_mod(std::vector<uint32_t>& m, size_t rows, size_t cols, size_t pivot_cols, uint32_t p, bool eliminate_above, uint32_t& det) noexcept {
+	det = 1;
+	size_t r = 0;
+	for (size_t c = 0; c < pivot_cols && r < rows; c++) {
+		size_t pivot_row = r;
+		while (pivot_row < rows && m[pivot_row * cols + c] == 0) {
+			pivot_row++;
+		}
+		if (pivot_row == rows) {
+			det = 0;
+			continue;
+		}
+
+		if (pivot_row != r) {
+			std::swap_ranges(m.begin() + r * cols, m.begin() + (r + 1) * cols, m.begin() + pivot_row * cols);
+			det = p - det;
+		}
+
+		uint32_t pivot = m[r * cols + c];
+		det = multiply_mod(det, pivot, p);
+
+		uint32_t pivot_inverse = inverse_mod(pivot, p);
+		for (size_t j = c; j < cols; j++) {
+			m[r * cols + j] = multiply_mod(m[r * cols + j], pivot_inverse, p);
+		}
+
+		for (size_t i = eliminate_above ? 0 : r + 1; i < rows; i++) {
+			uint32_t leading = m[i * cols + c];
+			if (i == r || leading == 0) {
+				continue;
+			}
+
+			//row_i - leading * row_r, as row_i + (p - leading) * row_r so it never goes negative
+			uint64_t negated = p - leading;
+			for (size_t j = c; j < cols; j++) {
+				m[i * cols + j] = static_cast<uint32_t>((m[i * cols + j] + negated * m[r * cols + j]) % p);
+			}
+		}
+		r++;
+	}
+	if (r < pivot_cols) {
+		det = 0;
+	}
+	return r;
+}
+
+//folds residue (mod p) into value (mod modulus), leaving value in [0, modulus * p); modulus is not updated
+static void crt_combine(bigint& value, const bigint& modulus, uint32_t modulus_inverse, uint32_t residue_p, uint32_t p) {
+	uint32_t value_p = residue(value, p);
+	uint32_t difference = residue_p >= value_p ? residue_p - value_p : residue_p + (p - value_p);
+	uint32_t step = multiply_mod(difference, modulus_inverse, p);
+	if (step != 0) {
+		value = value + modulus * bigint(step);
+	}
+}
+
+//the n/d with |n|, d < bound and n = value * d (mod modulus), by stopping the extended Euclidean algorithm half way
+//unique when modulus > 2 * bound^2; returns false if there isn't one
+static bool rational_reconstruct(const bigint& value, const bigint& modulus, const bigint& bound, rational& result) {
+	bigint r0 = modulus, r1 = value;
+	bigint t0, t1(1);
+	while (!(r1 < bound)) {
+		bigint quotient, remainder;
+		bigint::divide(r0, r1, quotient, remainder);
+
+		bigint t2 = t0 - quotient * t1;
+		r0 = std::move(r1);
+		r1 = std::move(remainder);
+		t0 = std::move(t1);
+		t1 = std::move(t2);
+	}
+
+	if (!(t1.abs() < bound) || !bigint::gcd(r1, t1).is_one()) {
+		return false;
+	}
+	result = r1.is_zero() ? rational(0) : rational::make_reduced(r1, t1);
+	return true;
+}
+
+static bigint power_of_two(size_t bits) {
+	bigint result(1);
+	for (; bits >= 32; bits -= 32) {
+		result = result * bigint(static_cast<uint64_t>(1) << 32);
+	}
+	return result * bigint(static_cast<uint64_t>(1) << bits);
+}
+
+static size_t rank_mod(const std::vector<bigint>& m, size_t rows, size_t cols, uint32_t p) {
+	std::vector<uint32_t> reduced = residues(m, p);
+	uint32_t det;
+	return eliminate_mod(reduced, rows, cols, cols, p, false, det);
+}
+
+//Rank modulo a prime never exceeds the true rank r, and only falls short when the prime divides every nonzero r x r minor.
+//Such a minor is below the Hadamard bound, so it has fewer prime factors above 2^30 than are taken here, and the largest
+//rank modulo them is exact.
+static size_t exact_rank(const std::vector<bigint>& m, size_t rows, size_t cols) {
+	size_t full_rank = std::min(rows, cols);
+
+	std::vector<uint32_t> primes;
+	next_primes(largest_prime_bound, hadamard_bits(m, rows, cols, full_rank) / bits_per_prime + 1, primes);
+
+	//the first prime already shows most matrices have full rank
+	size_t rank = rank_mod(m, rows, cols, primes[0]);
+	if (rank == full_rank) {
+		return rank;
+	}
+
+	std::vector<size_t> ranks(primes.size(), rank);
+	thread_pool::global().parallel_for(1, primes.size(), 1, [&](size_t lo, size_t hi) {
+		for (size_t k = lo; k < hi; k++) {
+			ranks[k] = rank_mod(m, rows, cols, primes[k]);
+		}
+	});
+	return *std::max_element(ranks.begin(), ranks.end());
+}
+
+//as with exact_rank, the largest rank modulo a few primes, but only a couple of random ones, so it's wrong with negligible
+//probability rather than never
+static std::vector<size_t> randomized_ranks(const std::vector<std::pair<const std::vector<bigint>*, size_t>>& matrices, size_t cols) {
+	std::random_device seed;
+	std::mt19937_64 rng(seed());
+
+	std::vector<uint32_t> primes;
+	for (size_t trial = 0; trial < rank_trials; trial++) {
+		primes.push_back(random_prime(rng));
+	}
+
+	std::vector<size_t> trial_ranks(rank_trials * matrices.size());
+	thread_pool::global().parallel_for(0, trial_ranks.size(), 1, [&](size_t lo, size_t hi) {
+		for (size_t k = lo; k < hi; k++) {
+			const auto& [m, rows] = matrices[k % matrices.size()];
+			trial_ranks[k] = rank_mod(*m, rows, cols, primes[k / matrices.size()]);
+		}
+	});
+
+	std::vector<size_t> ranks(matrices.size(), 0);
+	for (size_t k = 0; k < trial_ranks.size(); k++) {
+		ranks[k % matrices.size()] = std::max(ranks[k % matrices.size()], trial_ranks[k]);
+	}
+	return ranks;
+}
+
+template<>
+rational matrix::multimodular_determinant() const noexcept {
+	assert(rows == cols);
+
+	std::vector<bigint> row_scales;
+	std::vector<bigint> m = integer_rows(dense_elems(), cols, NULL, 0, rows, &row_scales);
+
+	//|det| is below the Hadamard bound, and the symmetric residue range has to cover it with either sign
+	std::vector<uint32_t> primes;
+	next_primes(largest_prime_bound, hadamard_bits(m, rows, cols, cols) / bits_per_prime + 1, primes);
+
+	std::vector<uint32_t> dets(primes.size());
+	thread_pool::global().parallel_for(0, primes.size(), 1, [&](size_t lo, size_t hi) {
+		for (size_t k = lo; k < hi; k++) {
+			std::vector<uint32_t> reduced = residues(m, primes[k]);
+			eliminate_mod(reduced, rows, cols, cols, primes[k], false, dets[k]);
+		}
+	});
+
+	bigint det, modulus(1);
+	for (size_t k = 0; k < primes.size(); k++) {
+		crt_combine(det, modulus, inverse_mod(residue(modulus, primes[k]), primes[k]), dets[k], primes[k]);
+		modulus = modulus * bigint(primes[k]);
+	}
+	if (bigint::compare(det + det, modulus) > 0) {
+		det = det - modulus;
+	}
+	if (det.is_zero()) {
+		return rational(0);
+	}
+
+	bigint scale(1);
+	for (auto& row_scale : row_scales) {
+		scale = scale * row_scale;
+	}
+	return rational::make_reduced(std::move(det), scale);
+}
+
+template<>
+size_t matrix::multimodular_rank() const noexcept {
+	std::vector<bigint> m = integer_rows(dense_elems(), cols, NULL, 0, rows, NULL);
+	return exact_rank(m, rows, cols);
+}
+
+template<>
+bool matrix::randomized_row_equivalent(const matrix& other) const noexcept {
+	assert(rows == other.rows && cols == other.cols);
+
+	//same row space iff stacking the two doesn't raise either rank
+	std::vector<bigint> mine = integer_rows(dense_elems(), cols, NULL, 0, rows, NULL);
+	std::vector<bigint> theirs = integer_rows(other.dense_elems(), cols, NULL, 0, rows, NULL);
+	std::vector<bigint> stacked(mine);
+	stacked.insert(stacked.end(), theirs.begin(), theirs.end());
+
+	std::vector<size_t> ranks = randomized_ranks({ std::make_pair(&mine, rows), std::make_pair(&theirs, rows), std::make_pair(&stacked, 2 * rows) }, cols);
+	return ranks[0] == ranks[1] && ranks[1] == ranks[2];
+}
+
+template<>
+std::optional<matrix> matrix::multimodular_solve(const matrix& rhs) const noexcept {
+	assert(rows == cols && rhs.rows == rows);
+
+	size_t width = cols + rhs.cols;
+	std::vector<bigint> m = integer_rows(dense_elems(), cols, rhs.dense_elems(), rhs.cols, rows, NULL);
+
+	//by Cramer's rule every solution entry is a ratio of two minors of [A | b], both below the Hadamard bound
+	size_t bound_bits = hadamard_bits(m, rows, width, cols);
+	size_t needed = (2 * bound_bits + 1) / bits_per_prime + 1;
+
+	//a prime dividing det(A) gives no solution, and fewer than needed primes can divide a nonzero det(A)
+	std::vector<uint32_t> primes;
+	std::vector<std::vector<uint32_t>> solutions;
+	size_t singular_primes = 0;
+	uint32_t prime_bound = largest_prime_bound;
+	while (primes.size() < needed) {
+		std::vector<uint32_t> batch;
+		prime_bound = next_primes(prime_bound, needed - primes.size(), batch);
+
+		std::vector<std::vector<uint32_t>> batch_solutions(batch.size());
+		thread_pool::global().parallel_for(0, batch.size(), 1, [&](size_t lo, size_t hi) {
+			for (size_t k = lo; k < hi; k++) {
+				std::vector<uint32_t> reduced = residues(m, batch[k]);
+
+				uint32_t det;
+				if (eliminate_mod(reduced, rows, width, cols, batch[k], true, det) < cols) {
+					continue;
+				}
+
+				batch_solutions[k].reserve(rows * rhs.cols);
+				for (size_t i = 0; i < rows; i++) {
+					batch_solutions[k].insert(batch_solutions[k].end(), reduced.begin() + i * width + cols, reduced.begin() + (i + 1) * width);
+				}
+			}
+		});
+
+		for (size_t k = 0; k < batch.size(); k++) {
+			if (batch_solutions[k].empty()) {
+				singular_primes++;
+				continue;
+			}
+			primes.push_back(batch[k]);
+			solutions.push_back(std::move(batch_solutions[k]));
+		}
+		if (singular_primes >= needed) {
+			return std::nullopt;
+		}
+	}
+
+	bigint modulus(1);
+	std::vector<bigint> combined(rows * rhs.cols);
+	for (size_t k = 0; k < primes.size(); k++) {
+		uint32_t modulus_inverse = inverse_mod(residue(modulus, primes[k]), primes[k]);
+		for (size_t i = 0; i < combined.size(); i++) {
+			crt_combine(combined[i], modulus, modulus_inverse, solutions[k][i], primes[k]);
+		}
+		modulus = modulus * bigint(primes[k]);
+	}
+
+	bigint bound = power_of_two(bound_bits);
+	std::vector<elem_type> new_elems(combined.size());
+	thread_pool::global().parallel_for(0, combined.size(), thread_pool::grain_for(bound_bits), [&](size_t lo, size_t hi) {
+		for (size_t i = lo; i < hi; i++) {
+			[[maybe_unused]] bool reconstructed = rational_reconstruct(combined[i], modulus, bound, new_elems[i]);
+			assert(reconstructed);
+		}
+	});
+	return matrix(rows, rhs.cols, new_elems);
+}
+
+template<>
+HulaScript::instance::value matrix::get_multimodular_determinant(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+	if (rows != cols) {
+		std::stringstream ss;
+		ss << "Matrix Explorer: Matrix crtDet expects a square matrix, but got a " << rows << "x" << cols << " matrix instead.";
+		instance.panic(ss.str());
+	}
+
+	return traits::wrap(multimodular_determinant(), instance);
+}
+
+template<>
+HulaScript::instance::value matrix::solve(std::span<const HulaScript::instance::value> arguments, HulaScript::instance& instance) {
+	if (arguments.size() != 1) {
+		std::stringstream ss;
+		ss << "Matrix Explorer: Matrix solve expects a right hand side matrix, got " << arguments.size() << " argument(s) instead.";
+		instance.panic(ss.str());
+	}
+
+	matrix* rhs = matrix::from_value(arguments[0], instance);
+	if (rhs == NULL) {
+		instance.panic("Matrix Explorer: You can only solve for a right hand side matrix.");
+		return HulaScript::instance::value();
+	}
+	if (rows != cols) {
+		std::stringstream ss;
+		ss << "Matrix Explorer: Matrix solve expects a square coefficient matrix, but got a " << rows << "x" << cols << " matrix instead.";
+		instance.panic(ss.str());
+	}
+	if (rhs->rows != rows) {
+		std::stringstream ss;
+		ss << "Matrix Explorer: Matrix solve expects a right hand side with " << rows << " row(s), but got " << rhs->rows << " instead.";
+		instance.panic(ss.str());
+	}
+
+	std::optional<matrix> solution = multimodular_solve(*rhs);
+	if (!solution.has_value()) {
+		instance.panic("Matrix Explorer: Cannot solve with a singular coefficient matrix.");
+		return HulaScript::instance::value();
+	}
+	return instance.add_foreign_object(std::make_unique<matrix>(std::move(solution.value())));
+}
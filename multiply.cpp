@@ -0,0 +1,160 @@
+#include "matrix.h"
+#include "thread_pool.h"
+
+using namespace MatrixExplorer;
+
+//Blocked matrix multiplication. Rows of the left operand are scaled to integers by the lcm of their denominators, as are
+//columns of the right operand, which is packed transposed so both operands are read contiguously along the common
+//dimension. Dot products are accumulated over integers tile by tile, and each output element is normalized (one gcd) at the end.
+
+static const size_t tile_size = 64;
+
+//entries are packed as machine integers when they fit in this many bits, so a tile's worth of products can't overflow 64 bits
+static const size_t small_bits = 26;
+
+namespace {
+	struct integer_panel {
+		std::vector<int32_t> small_elems; //used when every scaled entry fits in small_bits
+		std::vector<bigint> big_elems;
+		std::vector<bigint> scales; //scales[i] is the factor panel row i was multiplied by
+		bool is_small;
+	};
+
+	//accumulates per tile partial sums, spilling to a bigint only if the 64-bit total would overflow
+	struct dot_accumulator {
+		int64_t sum = 0;
+		bigint spilled;
+		bool has_spilled = false;
+
+		void add(int64_t product) {
+			if ((product > 0 && sum > INT64_MAX - product) || (product < 0 && sum < INT64_MIN - product)) {
+				spilled = spilled + bigint::from_int(sum);
+				has_spilled = true;
+				sum = 0;
+			}
+			sum += product;
+		}
+
+		bigint total() const {
+			return has_spilled ? spilled + bigint::from_int(sum) : bigint::from_int(sum);
+		}
+	};
+}
+
+//packs a strided view of elems into panel rows of length common, each scaled to integers
+static integer_panel pack_integer_panel(const rational* elems, size_t panel_rows, size_t common, size_t row_stride, size_t elem_stride) {
+	integer_panel panel;
+	panel.is_small = true;
+	panel.big_elems.reserve(panel_rows * common);
+	panel.scales.reserve(panel_rows);
+
+	for (size_t i = 0; i < panel_rows; i++) {
+		bigint scale(1);
+		for (size_t k = 0; k < common; k++) {
+			const rational& elem = elems[i * row_stride + k * elem_stride];
+			if (elem.is_big() || !elem.big_denominator().is_one()) {
+				bigint denom = elem.big_denominator();
+				scale = (scale / bigint::gcd(scale, denom)) * denom;
+			}
+		}
+
+		for (size_t k = 0; k < common; k++) {
+			const rational& elem = elems[i * row_stride + k * elem_stride];
+			bigint scaled = scale.is_one() ? elem.big_numerator() : elem.big_numerator() * (scale / elem.big_denominator());
+			if (scaled.bit_length() > small_bits) {
+				panel.is_small = false;
+			}
+			panel.big_elems.push_back(std::move(scaled));
+		}
+		panel.scales.push_back(std::move(scale));
+	}
+
+	if (panel.is_small) {
+		panel.small_elems.reserve(panel.big_elems.size());
+		for (auto& elem : panel.big_elems) {
+			int64_t magnitude = static_cast<int64_t>(elem.magnitude_uint64());
+			panel.small_elems.push_back(static_cast<int32_t>(elem.is_negative() ? -magnitude : magnitude));
+		}
+	}
+
+	return panel;
+}
+
+static rational normalize_dot(const bigint& dot, const bigint& row_scale, const bigint& col_scale) {
+	if (dot.is_zero()) {
+		return rational(0);
+	}
+	if (row_scale.is_one() && col_scale.is_one()) {
+		return rational::make_reduced(dot, bigint(1));
+	}
+	return rational::make_reduced(dot, row_scale * col_scale);
+}
+
+template<>
+matrix matrix::blocked_multiply(const matrix& operand) const noexcept {
+	size_t common = cols;
+	size_t out_cols = operand.cols;
+
+	//panels are packed straight from either layout, so strided views are never copied out first
+	integer_panel left = pack_integer_panel(buffer.get() + offset, rows, common, row_stride, col_stride);
+	integer_panel right = pack_integer_panel(operand.buffer.get() + operand.offset, out_cols, common, operand.col_stride, operand.row_stride); //packed transposed
+
+	std::vector<elem_type> new_elems(rows * out_cols);
+
+	//output rows are split across the thread pool in bands of tile_size, and each output element is still summed in the same order
+	if (left.is_small && right.is_small) {
+		thread_pool::global().parallel_for(0, rows, tile_size, [&](size_t lo, size_t hi) {
+			std::vector<dot_accumulator> tile(tile_size * tile_size);
+
+			for (size_t ii = lo; ii < hi; ii += tile_size) {
+				size_t i_end = std::min(ii + tile_size, hi);
+				for (size_t jj = 0; jj < out_cols; jj += tile_size) {
+					size_t j_end = std::min(jj + tile_size, out_cols);
+					std::fill(tile.begin(), tile.end(), dot_accumulator());
+
+					for (size_t kk = 0; kk < common; kk += tile_size) {
+						size_t k_end = std::min(kk + tile_size, common);
+						for (size_t i = ii; i < i_end; i++) {
+							const int32_t* a_row = left.small_elems.data() + i * common;
+							for (size_t j = jj; j < j_end; j++) {
+								const int32_t* b_row = right.small_elems.data() + j * common;
+
+								//each product fits in 2 * small_bits bits, so tile_size of them can't overflow
+								int64_t partial = 0;
+								for (size_t k = kk; k < k_end; k++) {
+									partial += static_cast<int64_t>(a_row[k]) * b_row[k];
+								}
+								tile[(i - ii) * tile_size + (j - jj)].add(partial);
+							}
+						}
+					}
+
+					for (size_t i = ii; i < i_end; i++) {
+						for (size_t j = jj; j < j_end; j++) {
+							new_elems[i * out_cols + j] = normalize_dot(tile[(i - ii) * tile_size + (j - jj)].total(), left.scales[i], right.scales[j]);
+						}
+					}
+				}
+			}
+		});
+	}
+	else {
+		thread_pool::global().parallel_for(0, rows, thread_pool::grain_for(common * out_cols), [&](size_t lo, size_t hi) {
+			for (size_t i = lo; i < hi; i++) {
+				for (size_t j = 0; j < out_cols; j++) {
+					bigint dot;
+					for (size_t k = 0; k < common; k++) {
+						const bigint& a = left.big_elems[i * common + k];
+						const bigint& b = right.big_elems[j * common + k];
+						if (!a.is_zero() && !b.is_zero()) {
+							dot = dot + a * b;
+						}
+					}
+					new_elems[i * out_cols + j] = normalize_dot(dot, left.scales[i], right.scales[j]);
+				}
+			}
+		});
+	}
+
+	return matrix(rows, out_cols, new_elems);
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "rational.h"
+
+namespace MatrixExplorer {
+	//integers modulo the mersenne prime 2^61 - 1, so products can be reduced with shifts instead of a division
+	class prime_field {
+	private:
+		uint64_t residue_;
+
+		//full 128 bit product of two 64 bit integers, split into its high and low halves
+		static void multiply_wide(uint64_t a, uint64_t b, uint64_t& high, uint64_t& low) noexcept {
+			uint64_t a_lo = a & 0xFFFFFFFFu, a_hi = a >> 32;
+			uint64_t b_lo = b & 0xFFFFFFFFu, b_hi = b >> 32;
+
+			uint64_t lo_lo = a_lo * b_lo;
+			uint64_t hi_lo = a_hi * b_lo;
+			uint64_t lo_hi = a_lo * b_hi;
+			uint64_t hi_hi = a_hi * b_hi;
+
+			uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+			high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+			low = (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+		}
+
+		//reduces a value below 2 * modulus
+		static uint64_t reduce_once(uint64_t value) noexcept {
+			return value >= modulus ? value - modulus : value;
+		}
+
+		static prime_field from_residue(uint64_t residue) noexcept {
+			prime_field result;
+			result.residue_ = residue;
+			return result;
+		}
+
+	public:
+		static const uint64_t modulus = (static_cast<uint64_t>(1) << 61) - 1;
+
+		prime_field(uint64_t integer) : residue_(integer % modulus) { }
+		prime_field() : residue_(0) { }
+
+		static prime_field from_int(int64_t integer) {
+			prime_field result(integer < 0 ? static_cast<uint64_t>(0) - static_cast<uint64_t>(integer) : static_cast<uint64_t>(integer));
+			return integer < 0 ? -result : result;
+		}
+
+		//maps a/b to a * b^-1; throws std::invalid_argument if the prime divides b
+		static prime_field from_rational(const rational& number) {
+			bigint numerator = number.big_numerator();
+			bigint denominator = number.big_denominator();
+			bigint big_modulus(modulus);
+
+			prime_field result(((numerator.abs()) % big_modulus).magnitude_uint64());
+			prime_field divisor((denominator % big_modulus).magnitude_uint64());
+			if (divisor.is_zero()) {
+				throw std::invalid_argument("Denominator is not invertible modulo 2^61 - 1.");
+			}
+
+			result = result / divisor;
+			return numerator.is_negative() ? -result : result;
+		}
+
+		const uint64_t residue() const noexcept {
+			return residue_;
+		}
+
+		const bool is_zero() const noexcept {
+			return residue_ == 0;
+		}
+
+		bool operator==(const prime_field& other) const noexcept {
+			return residue_ == other.residue_;
+		}
+
+		bool operator!=(const prime_field& other) const noexcept {
+			return residue_ != other.residue_;
+		}
+
+		prime_field operator+(const prime_field& other) const noexcept {
+			return from_residue(reduce_once(residue_ + other.residue_)); //both below 2^61, so no overflow
+		}
+
+		prime_field operator-() const noexcept {
+			return from_residue(residue_ == 0 ? 0 : modulus - residue_);
+		}
+
+		prime_field operator-(const prime_field& other) const noexcept {
+			return from_residue(residue_ >= other.residue_ ? residue_ - other.residue_ : residue_ + (modulus - other.residue_));
+		}
+
+		prime_field operator*(const prime_field& other) const noexcept {
+			uint64_t high, low;
+			multiply_wide(residue_, other.residue_, high, low);
+
+			//2^61 = 1 (mod 2^61 - 1), so the bits above 61 fold back onto the bottom
+			uint64_t folded = (low & modulus) + ((low >> 61) | (high << 3));
+			return from_residue(reduce_once(reduce_once(folded)));
+		}
+
+		//multiplicative inverse by fermat's little theorem; throws std::invalid_argument for zero
+		prime_field inverse() const {
+			if (is_zero()) {
+				throw std::invalid_argument("Cannot divide by zero.");
+			}
+
+			prime_field result(1);
+			prime_field base(*this);
+			for (uint64_t exponent = modulus - 2; exponent > 0; exponent >>= 1) {
+				if (exponent & 1) {
+					result = result * base;
+				}
+				base = base * base;
+			}
+			return result;
+		}
+
+		prime_field operator/(const prime_field& other) const {
+			return *this * other.inverse();
+		}
+
+		std::string to_string() const {
+			return std::to_string(residue_);
+		}
+
+		size_t compute_hash() const noexcept {
+			return static_cast<size_t>(residue_);
+		}
+	};
+}
\ No newline at end of file
@@ -4,7 +4,8 @@
 
 using namespace MatrixExplorer;
 
-std::string matrix::to_string() {
+template<typename number_type>
+std::string basic_matrix<number_type>::to_string() {
 	std::stringstream ss;
 	for (size_t i = 0; i < rows; i++) {
 		for (size_t j = 0; j < cols; j++) {
@@ -12,11 +13,15 @@ std::string matrix::to_string() {
 				ss << ", ";
 			}
 
-			matrix::elem_type elem = elems.get()[i * cols + j];
-			if (elem.is_zero()) { ss << "0"; } //to handle negative zero
-			else { ss << elem.to_string(); }
+			const elem_type& elem = at(i, j);
+			if (traits::is_zero(elem)) { ss << "0"; } //to handle negative zero
+			else { ss << traits::to_string(elem); }
 		}
 		ss << "\n";
 	}
 	return ss.str();
-}
\ No newline at end of file
+}
+
+template class MatrixExplorer::basic_matrix<rational>;
+template class MatrixExplorer::basic_matrix<double>;
+template class MatrixExplorer::basic_matrix<prime_field>;
\ No newline at end of file
@@ -1,31 +1,61 @@
 #include <stdexcept>
 #include <cassert>
+#include <cmath>
 #include "rational.h"
 #include "hash.h"
 
 using namespace MatrixExplorer;
 
+//appends digits with a decimal point inserted decimal_digits from the right
+static void write_decimal(std::string& s, const std::string& s2, size_t decimal_digits) {
+	if (decimal_digits == 0) {
+		s.append(s2);
+		return;
+	}
+
+	if (s2.length() < decimal_digits) {
+		s.push_back('0');
+		s.push_back('.');
+
+		for (size_t i = 0; i < decimal_digits - s2.length(); i++) {
+			s.push_back('0');
+		}
+
+		s.append(s2);
+	}
+	else {
+		for (size_t i = 0; i < s2.length() - decimal_digits; i++) {
+			s.push_back(s2.at(i));
+		}
+		s.push_back('.');
+		for (size_t i = s2.length() - decimal_digits; i < s2.length(); i++) {
+			s.push_back(s2.at(i));
+		}
+	}
+}
+
+static bigint pow10(size_t exponent) {
+	bigint result(1);
+	bigint ten(10);
+	for (size_t i = 0; i < exponent; i++) {
+		result = result * ten;
+	}
+	return result;
+}
+
 rational rational::parse(std::string str) {
-	uint64_t numerator = 0;
-	uint32_t denominator = 1;
+	std::string digits;
+	size_t decimal_digits = 0;
 
 	bool is_negate = false;
 	bool decimal_detected = false;
 	for (size_t i = 0; i < str.size(); i++) {
 		char c = str.at(i);
 		if (c >= '0' && c <= '9') {
-			if (numerator > UINT64_MAX / 10) {
-				throw std::invalid_argument("Overflow: Numerator is too large.");
-			}
-
-			numerator *= 10;
-			numerator += (c - '0');
+			digits.push_back(c);
 
 			if (decimal_detected) {
-				if (denominator > UINT32_MAX / 10) {
-					throw std::invalid_argument("Overflow: Denominator is too large.");
-				}
-				denominator *= 10;
+				decimal_digits++;
 			}
 		}
 		else if (c == '.') {
@@ -46,10 +76,138 @@ rational rational::parse(std::string str) {
 		}
 	}
 
-	return rational(numerator, denominator, is_negate);
+	//19 digits always fit in 64 bits, and 10^9 in 32 bits
+	if (digits.size() <= 19 && decimal_digits <= 9) {
+		uint64_t numerator = 0;
+		uint32_t denominator = 1;
+		for (char c : digits) {
+			numerator = numerator * 10 + (c - '0');
+		}
+		for (size_t i = 0; i < decimal_digits; i++) {
+			denominator *= 10;
+		}
+		return make_reduced(numerator, denominator, is_negate);
+	}
+
+	bigint numerator = bigint::parse(digits);
+	return make_reduced(is_negate ? -numerator : numerator, pow10(decimal_digits));
+}
+
+rational rational::from_double(double number) {
+	if (!std::isfinite(number)) {
+		throw std::invalid_argument("Cannot convert an infinite or NaN number to an exact one.");
+	}
+
+	int exponent;
+	double mantissa = std::frexp(std::abs(number), &exponent);
+
+	//53 significant bits, as an integer
+	bigint numerator(static_cast<uint64_t>(std::ldexp(mantissa, 53)), number < 0);
+	exponent -= 53;
+
+	bigint power(1);
+	int shift = std::abs(exponent);
+	for (; shift >= 32; shift -= 32) {
+		power = power * bigint(static_cast<uint64_t>(1) << 32);
+	}
+	power = power * bigint(static_cast<uint64_t>(1) << shift);
+	return exponent >= 0 ? make_reduced(numerator * power, bigint(1)) : make_reduced(numerator, power);
+}
+
+rational rational::make_reduced(bigint numerator, bigint denominator) {
+	if (denominator.is_zero()) {
+		throw std::invalid_argument("Cannot divide by zero.");
+	}
+	if (denominator.is_negative()) {
+		numerator = -numerator;
+		denominator = -denominator;
+	}
+
+	bigint common = bigint::gcd(numerator, denominator);
+	if (!common.is_one()) {
+		numerator = numerator / common;
+		denominator = denominator / common;
+	}
+
+	if (numerator.fits_uint64() && denominator.bit_length() <= 32) {
+		return make_coprime(numerator.magnitude_uint64(), denominator.magnitude_uint64(), numerator.is_negative());
+	}
+
+	rational result;
+	result.word = reinterpret_cast<uintptr_t>(new big_spill(std::move(numerator), std::move(denominator))) | spilled_tag | big_tag;
+	return result;
+}
+
+void rational::release_spill() noexcept {
+	if (spilled()->references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		return;
+	}
+
+	if (word & big_tag) {
+		delete big();
+	}
+	else {
+		delete wide();
+	}
 }
 
-std::string MatrixExplorer::rational::to_string(bool print_as_frac) {
+rational rational::big_add(const rational& a, const rational& b) {
+	bigint a_denom = a.big_denominator();
+	bigint b_denom = b.big_denominator();
+	return make_reduced(a.big_numerator() * b_denom + b.big_numerator() * a_denom, a_denom * b_denom);
+}
+
+rational rational::big_multiply(const rational& a, const rational& b) {
+	return make_reduced(a.big_numerator() * b.big_numerator(), a.big_denominator() * b.big_denominator());
+}
+
+rational rational::big_divide(const rational& a, const rational& b) {
+	return make_reduced(a.big_numerator() * b.big_denominator(), a.big_denominator() * b.big_numerator());
+}
+
+std::string MatrixExplorer::rational::to_string(bool print_as_frac) const {
+	uint64_t numerator, denominator;
+	bool is_negate;
+	if (!unpack(numerator, denominator, is_negate)) {
+		const big_spill* big = this->big();
+
+		std::string s;
+		if (print_as_frac) {
+			s.append(big->numerator.to_string());
+			if (!big->denominator.is_one()) {
+				s.push_back('/');
+				s.append(big->denominator.to_string());
+			}
+			return s;
+		}
+
+		//only denominators of the form 2^a * 5^b have a terminating decimal expansion
+		bigint rest = big->denominator;
+		bigint two(2);
+		bigint five(5);
+		size_t twos = 0;
+		size_t fives = 0;
+		while (rest.mod_word(2) == 0) {
+			rest = rest / two;
+			twos++;
+		}
+		while (rest.mod_word(5) == 0) {
+			rest = rest / five;
+			fives++;
+		}
+		if (!rest.is_one()) {
+			return to_string(true);
+		}
+
+		size_t decimal_digits = std::max(twos, fives);
+		bigint scaled = big->numerator.abs() * (pow10(decimal_digits) / big->denominator);
+		if (big->numerator.is_negative()) {
+			s.push_back('-');
+		}
+		write_decimal(s, scaled.to_string(), decimal_digits);
+		return s;
+	}
+
 	std::string s;
 	if (is_negate) {
 		s.push_back('-');
@@ -78,42 +236,46 @@ std::string MatrixExplorer::rational::to_string(bool print_as_frac) {
 		}
 
 		uint64_t factor = denom10 / denominator;
-		if (numerator > UINT64_MAX / factor) {
-			return to_string(true);
-		}
 
 		std::string s2;
-		write_int(s2, numerator * factor);
-
-		if (decimal_digits == 0) {
-			return s2;
-		}
-
-		if (s2.length() < decimal_digits) {
-			s.push_back('0');
-			s.push_back('.');
-
-			for (size_t i = 0; i < decimal_digits - s2.length(); i++) {
-				s.push_back('0');
-			}
-
-			s.append(s2);
+		if (numerator > UINT64_MAX / factor) {
+			s2 = (bigint(numerator) * bigint(factor)).to_string();
 		}
 		else {
-			for (size_t i = 0; i < s2.length() - decimal_digits; i++) {
-				s.push_back(s2.at(i));
-			}
-			s.push_back('.');
-			for (size_t i = s2.length() - decimal_digits; i < s2.length(); i++) {
-				s.push_back(s2.at(i));
-			}
+			write_int(s2, numerator * factor);
 		}
+
+		write_decimal(s, s2, decimal_digits);
 	}
 
 	return s;
 }
 
-size_t MatrixExplorer::rational::compute_hash() {
+double MatrixExplorer::rational::to_double() const {
+	uint64_t numerator, denominator;
+	bool is_negate;
+	if (!unpack(numerator, denominator, is_negate)) {
+		const big_spill* big = this->big();
+
+		//scale both sides down to their leading bits so huge values don't overflow to inf/inf
+		size_t num_shift, denom_shift;
+		double num = static_cast<double>(big->numerator.leading_bits(num_shift));
+		double denom = static_cast<double>(big->denominator.leading_bits(denom_shift));
+		double result = std::ldexp(num / denom, static_cast<int>(num_shift) - static_cast<int>(denom_shift));
+		return big->numerator.is_negative() ? -result : result;
+	}
+
+	double result = static_cast<double>(numerator) / static_cast<double>(denominator);
+	return is_negate ? -result : result;
+}
+
+size_t MatrixExplorer::rational::compute_hash() const {
+	uint64_t numerator, denominator;
+	bool is_negate;
+	if (!unpack(numerator, denominator, is_negate)) {
+		return HulaScript::Hash::combine(big()->numerator.compute_hash(), big()->denominator.compute_hash());
+	}
+
 	size_t lhs = denominator;
 	lhs = lhs << sizeof(bool);
 	lhs += static_cast<size_t>(is_negate);
@@ -1,19 +1,107 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include "bigint.h"
 
 namespace MatrixExplorer {
 	class rational {
 	private:
-		uint64_t numerator;
-		uint32_t denominator;
+		//A value is one tagged word. Small fractions are packed into the word itself, and anything wider spills to a
+		//reference counted block the word points to (blocks are at least 8 byte aligned, leaving the low bits for the tag).
+		//  bit 0 clear:           packed; bit 1 is the sign, bits 2-25 the denominator and bits 26-63 the numerator
+		//  bit 0 set, bit 1 clear: wide_spill, a 64 bit numerator over a 32 bit denominator
+		//  bits 0 and 1 set:      big_spill, arbitrary precision numerator and denominator
+		//Values always take the narrowest form they fit, so each value has exactly one representation.
+		static const uint64_t spilled_tag = 1;
+		static const uint64_t big_tag = 2;
+		static const uint64_t tag_mask = 3;
 
-		bool is_negate;
+		static const uint64_t packed_sign = 2;
+		static const size_t packed_denominator_shift = 2;
+		static const size_t packed_numerator_shift = 26;
+		static const uint64_t packed_denominator_max = (static_cast<uint64_t>(1) << (packed_numerator_shift - packed_denominator_shift)) - 1;
+		static const uint64_t packed_numerator_max = (static_cast<uint64_t>(1) << (64 - packed_numerator_shift)) - 1;
+
+		struct spill {
+			mutable std::atomic<size_t> references;
+
+			spill() : references(1) { }
+		};
+
+		struct wide_spill : spill {
+			uint64_t numerator;
+			uint32_t denominator;
+			bool is_negate;
+
+			wide_spill(uint64_t numerator, uint32_t denominator, bool is_negate) : numerator(numerator), denominator(denominator), is_negate(is_negate) { }
+		};
+
+		struct big_spill : spill {
+			bigint numerator; //carries the sign
+			bigint denominator; //always positive
+
+			big_spill(bigint numerator, bigint denominator) : numerator(std::move(numerator)), denominator(std::move(denominator)) { }
+		};
+
+		uint64_t word;
+
+		static constexpr uint64_t pack(uint64_t numerator, uint64_t denominator, bool is_negate) noexcept {
+			return (numerator << packed_numerator_shift) | (denominator << packed_denominator_shift) | (is_negate ? packed_sign : 0);
+		}
+
+		const spill* spilled() const noexcept {
+			return reinterpret_cast<const spill*>(static_cast<uintptr_t>(word & ~tag_mask));
+		}
+		const wide_spill* wide() const noexcept {
+			return static_cast<const wide_spill*>(spilled());
+		}
+		const big_spill* big() const noexcept {
+			return static_cast<const big_spill*>(spilled());
+		}
+
+		void retain() const noexcept {
+			if (word & spilled_tag) {
+				spilled()->references.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		void release() noexcept {
+			if (word & spilled_tag) {
+				release_spill();
+			}
+		}
+		void release_spill() noexcept;
+
+		//the value as a 64 bit numerator over a 32 bit denominator, which every form but big_spill fits
+		bool unpack(uint64_t& numerator, uint64_t& denominator, bool& is_negate) const noexcept {
+			if (!(word & spilled_tag)) {
+				numerator = word >> packed_numerator_shift;
+				denominator = (word >> packed_denominator_shift) & packed_denominator_max;
+				is_negate = word & packed_sign;
+				return true;
+			}
+			if (word & big_tag) {
+				return false;
+			}
+
+			numerator = wide()->numerator;
+			denominator = wide()->denominator;
+			is_negate = wide()->is_negate;
+			return true;
+		}
 
 		//euclids method gcd
 		static const uint64_t gcd(uint64_t a, uint64_t b) noexcept {
-			return b == 0 ? a : gcd(b, a % b);
+			while (b != 0) {
+				uint64_t t = a % b;
+				a = b;
+				b = t;
+			}
+			return a;
 		}
 
 		static const uint64_t lcm(uint64_t a, uint64_t b) noexcept {
@@ -23,6 +111,9 @@ namespace MatrixExplorer {
 		static void write_int(std::string& dest, uint64_t a) {
 			uint64_t to_print = a;
 			size_t pos = dest.size();
+			if (to_print == 0) {
+				dest.push_back('0');
+			}
 			while (to_print > 0) {
 				dest.push_back('0' + (to_print % 10));
 				to_print /= 10;
@@ -30,97 +121,246 @@ namespace MatrixExplorer {
 			std::reverse(dest.begin() + pos, dest.end());
 		}
 
-		rational(uint64_t numerator, uint32_t denominator, bool is_negate=false) noexcept(false) : numerator(numerator), denominator(denominator), is_negate(is_negate&& numerator != 0) {
-			if (denominator == 0) {
-				throw std::invalid_argument("Cannot divide by zero.");
+		//stores an already reduced fraction in the narrowest form it fits
+		static rational make_coprime(uint64_t numerator, uint64_t denominator, bool is_negate) {
+			if (numerator == 0) {
+				return rational(0);
+			}
+			if (denominator > UINT32_MAX) {
+				return make_reduced(bigint(numerator, is_negate), bigint(denominator));
 			}
-			
+
+			rational result;
+			if (numerator <= packed_numerator_max && denominator <= packed_denominator_max) {
+				result.word = pack(numerator, denominator, is_negate);
+			}
+			else {
+				result.word = reinterpret_cast<uintptr_t>(new wide_spill(numerator, static_cast<uint32_t>(denominator), is_negate)) | spilled_tag;
+			}
+			return result;
+		}
+
+		static rational make_reduced(uint64_t numerator, uint64_t denominator, bool is_negate) {
 			uint64_t common = gcd(numerator, denominator);
-			this->numerator /= common;
-			this->denominator /= common;
+			return make_coprime(numerator / common, denominator / common, is_negate);
 		}
 
+		//slow paths taken when an operand is promoted, or the inline computation would overflow
+		static rational big_add(const rational& a, const rational& b);
+		static rational big_multiply(const rational& a, const rational& b);
+		static rational big_divide(const rational& a, const rational& b);
+
 	public:
-		rational(uint64_t integer) : numerator(integer), denominator(1), is_negate(false) { }
-		rational() : rational(0) { }
+		rational(uint64_t integer) : word(pack(integer, 1, false)) {
+			if (integer > packed_numerator_max) {
+				word = reinterpret_cast<uintptr_t>(new wide_spill(integer, 1, false)) | spilled_tag;
+			}
+		}
+		rational() noexcept : word(pack(0, 1, false)) { }
+
+		rational(const rational& other) noexcept : word(other.word) {
+			retain();
+		}
+		rational(rational&& other) noexcept : word(other.word) {
+			other.word = pack(0, 1, false);
+		}
+
+		rational& operator=(const rational& other) noexcept {
+			other.retain();
+			release();
+			word = other.word;
+			return *this;
+		}
+		rational& operator=(rational&& other) noexcept {
+			if (this != &other) {
+				release();
+				word = other.word;
+				other.word = pack(0, 1, false);
+			}
+			return *this;
+		}
+
+		~rational() {
+			release();
+		}
 
 		static rational parse(std::string str);
-		std::string to_string(bool print_as_frac = false);
 
-		const bool is_zero() const noexcept {
-			return numerator == 0;
+		//exact value of a finite double (every double is a dyadic fraction); throws std::invalid_argument for inf/nan
+		static rational from_double(double number);
+		std::string to_string(bool print_as_frac = false) const;
+
+		//reduces a fraction, demoting it to the narrowest form it fits
+		static rational make_reduced(bigint numerator, bigint denominator);
+
+		bigint big_numerator() const {
+			uint64_t numerator, denominator;
+			bool is_negate;
+			return unpack(numerator, denominator, is_negate) ? bigint(numerator, is_negate) : big()->numerator;
 		}
 
-		bool operator==(rational const& rat) {
-			return numerator == rat.numerator && denominator == rat.denominator && is_negate == rat.is_negate;
+		bigint big_denominator() const {
+			uint64_t numerator, denominator;
+			bool is_negate;
+			return unpack(numerator, denominator, is_negate) ? bigint(denominator) : big()->denominator;
 		}
 
-		bool operator!=(rational const& rat) {
-			return numerator != rat.numerator || denominator != rat.denominator || is_negate != rat.is_negate;
+		//the value as a signed numerator over a positive denominator, when both fit in 64 bits
+		bool to_fraction(int64_t& numerator, uint64_t& denominator) const noexcept {
+			uint64_t magnitude;
+			bool is_negate;
+			if (!unpack(magnitude, denominator, is_negate) || magnitude > INT64_MAX) {
+				return false;
+			}
+			numerator = is_negate ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+			return true;
 		}
 
-		rational operator+(rational const& rat) {
-			if (rat.is_zero()) {
-				return *this;
+		static rational from_fraction(int64_t numerator, uint64_t denominator) {
+			if (denominator == 0) {
+				throw std::invalid_argument("Cannot divide by zero.");
 			}
+			return make_reduced(numerator < 0 ? 0 - static_cast<uint64_t>(numerator) : static_cast<uint64_t>(numerator), denominator, numerator < 0);
+		}
 
-			uint32_t new_denom = lcm(denominator, rat.denominator);
-			uint64_t a_num = numerator * (new_denom / denominator);
-			uint64_t b_num = rat.numerator * (new_denom / rat.denominator);
+		const bool is_zero() const noexcept {
+			return word == pack(0, 1, false);
+		}
+
+		const bool is_big() const noexcept {
+			return (word & tag_mask) == tag_mask;
+		}
 
-			if (is_negate == rat.is_negate) {
-				return rational(a_num + b_num, new_denom, is_negate);
+		//bytes of spill block this value keeps alive, counted in full even when the block is shared
+		size_t footprint() const noexcept {
+			if (!(word & spilled_tag)) {
+				return 0;
 			}
-			
-			if (a_num > b_num) {
-				return rational(a_num - b_num, new_denom, is_negate);
+			if (word & big_tag) {
+				return sizeof(big_spill) + big()->numerator.footprint() + big()->denominator.footprint();
 			}
-			else {
-				return rational(b_num - a_num, new_denom, rat.is_negate);
+			return sizeof(wide_spill);
+		}
+
+		bool operator==(rational const& rat) const noexcept {
+			if (word == rat.word) {
+				return true;
+			}
+			if (!(word & spilled_tag) || (word & tag_mask) != (rat.word & tag_mask)) {
+				return false; //forms are canonical, so different forms are different values
 			}
+
+			if (word & big_tag) {
+				return big()->numerator == rat.big()->numerator && big()->denominator == rat.big()->denominator;
+			}
+			return wide()->numerator == rat.wide()->numerator && wide()->denominator == rat.wide()->denominator && wide()->is_negate == rat.wide()->is_negate;
 		}
 
-		rational operator-(rational const& rat) {
+		bool operator!=(rational const& rat) const noexcept {
+			return !(*this == rat);
+		}
+
+		rational operator+(rational const& rat) const {
 			if (rat.is_zero()) {
 				return *this;
 			}
+			if (is_zero()) {
+				return rat;
+			}
 
-			uint32_t new_denom = lcm(denominator, rat.denominator);
-			uint64_t a_num = numerator * (new_denom / denominator);
-			uint64_t b_num = rat.numerator * (new_denom / rat.denominator);
+			uint64_t a_numerator, a_denominator, b_numerator, b_denominator;
+			bool a_negate, b_negate;
+			if (unpack(a_numerator, a_denominator, a_negate) && rat.unpack(b_numerator, b_denominator, b_negate)) {
+				uint64_t common = gcd(a_denominator, b_denominator);
+				uint64_t a_scale = b_denominator / common;
+				uint64_t b_scale = a_denominator / common;
 
-			if (is_negate != rat.is_negate) {
-				return rational(a_num + b_num, new_denom, is_negate);
-			}
-			
-			if (a_num > b_num) {
-				return rational(a_num - b_num, new_denom, is_negate);
-			}
-			else {
-				return rational(b_num - a_num, new_denom, !is_negate);
+				if (a_numerator <= UINT64_MAX / a_scale && b_numerator <= UINT64_MAX / b_scale) {
+					uint64_t new_denom = b_scale * b_denominator; //product of two 32-bit values, cannot overflow
+					uint64_t a_num = a_numerator * a_scale;
+					uint64_t b_num = b_numerator * b_scale;
+
+					if (a_negate == b_negate) {
+						if (a_num <= UINT64_MAX - b_num) {
+							return make_reduced(a_num + b_num, new_denom, a_negate);
+						}
+					}
+					else if (a_num > b_num) {
+						return make_reduced(a_num - b_num, new_denom, a_negate);
+					}
+					else {
+						return make_reduced(b_num - a_num, new_denom, b_negate);
+					}
+				}
 			}
+
+			return big_add(*this, rat);
 		}
 
-		rational operator-() {
-			return rational(numerator, denominator, !is_negate);
+		rational operator-(rational const& rat) const {
+			return *this + (-rat);
 		}
 
-		rational operator*(rational const& rat) {
-			return rational(numerator * rat.numerator, denominator * rat.denominator, is_negate != rat.is_negate);
+		rational operator-() const {
+			if (is_big()) {
+				return make_reduced(-big()->numerator, big()->denominator);
+			}
+
+			uint64_t numerator = 0, denominator = 1;
+			bool is_negate = false;
+			unpack(numerator, denominator, is_negate);
+			return make_coprime(numerator, denominator, !is_negate);
 		}
 
-		rational operator/(rational const& rat) {
-			return rational(numerator * rat.denominator, denominator * rat.numerator, is_negate != rat.is_negate);
+		rational operator*(rational const& rat) const {
+			uint64_t a_numerator, a_denominator, b_numerator, b_denominator;
+			bool a_negate, b_negate;
+			if (unpack(a_numerator, a_denominator, a_negate) && rat.unpack(b_numerator, b_denominator, b_negate)) {
+				//cross reduce first, so the result is already in lowest terms
+				uint64_t g1 = gcd(a_numerator, b_denominator);
+				uint64_t g2 = gcd(b_numerator, a_denominator);
+				uint64_t a = a_numerator / g1;
+				uint64_t b = b_numerator / g2;
+
+				if (a == 0 || b <= UINT64_MAX / a) {
+					return make_coprime(a * b, (a_denominator / g2) * (b_denominator / g1), a_negate != b_negate);
+				}
+			}
+
+			return big_multiply(*this, rat);
 		}
 
-		rational inverse() {
-			return rational(denominator, numerator, is_negate);
+		rational operator/(rational const& rat) const {
+			if (rat.is_zero()) {
+				throw std::invalid_argument("Cannot divide by zero.");
+			}
+
+			uint64_t a_numerator, a_denominator, b_numerator, b_denominator;
+			bool a_negate, b_negate;
+			if (unpack(a_numerator, a_denominator, a_negate) && rat.unpack(b_numerator, b_denominator, b_negate)) {
+				uint64_t g1 = gcd(a_numerator, b_numerator);
+				uint64_t g2 = gcd(a_denominator, b_denominator);
+				uint64_t a = a_numerator / g1;
+				uint64_t b = b_denominator / g2;
+				uint64_t c = a_denominator / g2;
+				uint64_t d = b_numerator / g1;
+
+				if ((a == 0 || b <= UINT64_MAX / a) && d <= UINT32_MAX) {
+					return make_coprime(a * b, c * d, a_negate != b_negate);
+				}
+			}
+
+			return big_divide(*this, rat);
 		}
 
-		double to_double() {
-			return static_cast<double>(numerator) / static_cast<double>(denominator);
+		rational inverse() const {
+			return rational(1) / *this;
 		}
 
-		size_t compute_hash();
+		double to_double() const;
+
+		size_t compute_hash() const;
 	};
+
+	static_assert(sizeof(rational) == sizeof(uint64_t), "rational should pack into a single word");
 }
\ No newline at end of file
@@ -1,8 +1,19 @@
+#include <cmath>
 #include "matrix.h"
+#include "thread_pool.h"
+#include "simd.h"
 
 using namespace MatrixExplorer;
 
-void matrix::swap_rows(size_t a, size_t b) {
+template<typename number_type>
+void basic_matrix<number_type>::swap_rows(size_t a, size_t b) {
+	elem_type* elems = own_elems();
+
+	if constexpr (std::is_same_v<elem_type, double>) {
+		simd::active().swap(&elems[a * cols], &elems[b * cols], cols);
+		return;
+	}
+
 	for (size_t i = 0; i < cols; i++) {
 		auto a_elem = elems[a * cols + i];
 		elems[a * cols + i] = elems[b * cols + i];
@@ -10,32 +21,59 @@ void matrix::swap_rows(size_t a, size_t b) {
 	}
 }
 
-void matrix::scale_row(size_t k, elem_type scalar) {
+template<typename number_type>
+void basic_matrix<number_type>::scale_row(size_t k, elem_type scalar) {
+	elem_type* elems = own_elems();
+
+	if constexpr (std::is_same_v<elem_type, double>) {
+		simd::active().scale(&elems[k * cols], scalar, cols);
+		return;
+	}
+
 	for (size_t i = 0; i < cols; i++) {
 		elems[k * cols + i] = elems[k * cols + i] * scalar;
 	}
 }
 
-void matrix::add_rows(size_t add_to, size_t how_much) {
+template<typename number_type>
+void basic_matrix<number_type>::add_rows(size_t add_to, size_t how_much) {
+	elem_type* elems = own_elems();
+
+	if constexpr (std::is_same_v<elem_type, double>) {
+		simd::active().add(&elems[add_to * cols], &elems[how_much * cols], &elems[add_to * cols], cols);
+		return;
+	}
+
 	for (size_t i = 0; i < cols; i++) {
 		elems[add_to * cols + i] = elems[add_to * cols + i] + elems[how_much * cols + i];
 	}
 }
 
-void matrix::subtract_rows(size_t subtract_from, size_t how_much, elem_type scale) {
+template<typename number_type>
+void basic_matrix<number_type>::subtract_rows(size_t subtract_from, size_t how_much, elem_type scale) {
+	elem_type* elems = own_elems();
+
+	if constexpr (std::is_same_v<elem_type, double>) {
+		simd::active().multiply_subtract(&elems[subtract_from * cols], &elems[how_much * cols], scale, cols);
+		return;
+	}
+
 	for (size_t i = 0; i < cols; i++) {
 		elems[subtract_from * cols + i] = elems[subtract_from * cols + i] - elems[how_much * cols + i] * scale;
 	}
 }
 
-matrix matrix::reduce() const noexcept {
-	std::vector<elem_type> new_elems(elems.get(), elems.get() + (rows * cols));
-	matrix mat(rows, cols, new_elems);
+template<typename number_type>
+basic_matrix<number_type> basic_matrix<number_type>::reduce() const noexcept {
+	const elem_type* elems = dense_elems();
+	std::vector<elem_type> new_elems(elems, elems + (rows * cols));
+	basic_matrix mat(rows, cols, new_elems);
+	const elem_type* mat_elems = mat.buffer.get();
 
 	for (size_t i = 0; i < cols; i++) {
 		bool found_nonzero = false;
 		for (size_t j = i; j < rows; j++) {
-			if (!mat.elems[j * cols + i].is_zero()) {
+			if (!traits::is_zero(mat_elems[j * cols + i])) {
 				mat.swap_rows(i, j);
 				found_nonzero = true;
 				break;
@@ -43,45 +81,116 @@ matrix matrix::reduce() const noexcept {
 		}
 
 		if (found_nonzero) {
-			auto non_zero_elem = mat.elems[i * cols + i];
-			for (size_t j = i + 1; j < rows; j++) {
-				auto leading = mat.elems[j * cols + i];
-				if (!leading.is_zero()) {
-					mat.subtract_rows(j, i, leading / non_zero_elem);
+			//rows below the pivot only read the pivot row, so they can be eliminated independently
+			auto non_zero_elem = mat_elems[i * cols + i];
+			thread_pool::global().parallel_for(i + 1, rows, thread_pool::grain_for(cols), [&](size_t lo, size_t hi) {
+				for (size_t j = lo; j < hi; j++) {
+					auto leading = mat_elems[j * cols + i];
+					if (!traits::is_zero(leading)) {
+						mat.subtract_rows(j, i, leading / non_zero_elem);
+					}
 				}
-			}
+			});
 		}
 	}
 
 	return mat;
 }
 
-matrix matrix::row_reduce() const noexcept {
-	matrix reduced = reduce();
-
-	for (size_t i = 0; i < std::min(reduced.rows, reduced.cols); i++) {
-		elem_type elem = reduced.elems[i * cols + i];
-		if (!elem.is_zero()) {
-			reduced.scale_row(i, elem_type(1) / elem);
+template<typename number_type>
+basic_matrix<number_type> basic_matrix<number_type>::row_reduce() const noexcept {
+	basic_matrix reduced = reduce();
+	elem_type* reduced_elems = reduced.own_elems();
+
+	size_t diagonal = std::min(reduced.rows, reduced.cols);
+	thread_pool::global().parallel_for(0, diagonal, thread_pool::grain_for(cols), [&](size_t lo, size_t hi) {
+		for (size_t i = lo; i < hi; i++) {
+			elem_type elem = reduced_elems[i * cols + i];
+			if (!traits::is_zero(elem)) {
+				reduced.scale_row(i, elem_type(1) / elem);
+			}
 		}
-	}
+	});
+
+	//row i only ever subtracts rows below it as they were before their own (later) turn, so reading those from a
+	//snapshot makes every row independent, and gives the same result as sweeping them in order
+	std::vector<elem_type> scaled(reduced_elems, reduced_elems + (rows * cols));
+	thread_pool::global().parallel_for(0, diagonal, thread_pool::grain_for(cols * diagonal), [&](size_t lo, size_t hi) {
+		for (size_t i = lo; i < hi; i++) {
+			for (size_t j = i + 1; j < diagonal; j++) {
+				elem_type elem = reduced_elems[i * cols + j];
+				if constexpr (std::is_same_v<elem_type, double>) {
+					simd::active().multiply_subtract(&reduced_elems[i * cols], &scaled[j * cols], elem, cols);
+					continue;
+				}
 
-	for (size_t i = 0; i < std::min(reduced.rows, reduced.cols); i++) {
-		for (size_t j = i + 1; j < std::min(reduced.rows, reduced.cols); j++) {
-			elem_type elem = reduced.elems[i * cols + j];
-			reduced.subtract_rows(i, j, elem);
+				for (size_t k = 0; k < cols; k++) {
+					reduced_elems[i * cols + k] = reduced_elems[i * cols + k] - scaled[j * cols + k] * elem;
+				}
+			}
 		}
-	}
+	});
 
 	return reduced;
 }
 
-bool matrix::is_ref() const noexcept {
+template<typename number_type>
+number_type basic_matrix<number_type>::determinant() const noexcept {
+	assert(rows == cols);
+
+	//plain Gaussian elimination; exact types pivot on the first nonzero entry, doubles on the largest in magnitude
+	const elem_type* elems = dense_elems();
+	std::vector<elem_type> m(elems, elems + (rows * cols));
+	elem_type det = elem_type(1);
+	for (size_t c = 0; c < cols; c++) {
+		size_t pivot_row = c;
+		for (size_t i = c; i < rows; i++) {
+			if constexpr (std::is_same_v<elem_type, double>) {
+				if (std::abs(m[i * cols + c]) > std::abs(m[pivot_row * cols + c])) {
+					pivot_row = i;
+				}
+			}
+			else if (!traits::is_zero(m[i * cols + c])) {
+				pivot_row = i;
+				break;
+			}
+		}
+
+		if (traits::is_zero(m[pivot_row * cols + c])) {
+			return elem_type(0);
+		}
+		if (pivot_row != c) {
+			std::swap_ranges(m.begin() + c * cols, m.begin() + (c + 1) * cols, m.begin() + pivot_row * cols);
+			det = -det;
+		}
+
+		elem_type pivot = m[c * cols + c];
+		det = det * pivot;
+		thread_pool::global().parallel_for(c + 1, rows, thread_pool::grain_for(cols - c), [&](size_t lo, size_t hi) {
+			for (size_t i = lo; i < hi; i++) {
+				elem_type factor = m[i * cols + c] / pivot;
+				if constexpr (std::is_same_v<elem_type, double>) {
+					simd::active().multiply_subtract(&m[i * cols + c], &m[c * cols + c], factor, cols - c);
+					continue;
+				}
+
+				for (size_t j = c; j < cols; j++) {
+					m[i * cols + j] = m[i * cols + j] - m[c * cols + j] * factor;
+				}
+			}
+		});
+	}
+	return det;
+}
+
+template<typename number_type>
+bool basic_matrix<number_type>::is_ref() const noexcept {
+	const elem_type* elems = dense_elems();
 	std::optional<size_t> last_pivot_pos = std::nullopt;
 	for (size_t i = 0; i < rows; i++) {
 		bool found_pivot = false;
 		for (size_t j = 0; j < cols; j++) {
-			if (!elems[i * cols + j].is_zero()) { //potential pivot detected
+			if (!traits::is_zero(elems[i * cols + j])) { //potential pivot detected
 				if (last_pivot_pos.has_value() && j <= last_pivot_pos.value()) {
 					return false;
 				}
@@ -98,12 +207,14 @@ bool matrix::is_ref() const noexcept {
 	return true;
 }
 
-bool matrix::is_rref() const noexcept {
+template<typename number_type>
+bool basic_matrix<number_type>::is_rref() const noexcept {
+	const elem_type* elems = dense_elems();
 	std::optional<size_t> last_pivot_pos = std::nullopt;
 	for (size_t i = 0; i < rows; i++) {
 		bool found_pivot = false;
 		for (size_t j = 0; j < cols; j++) {
-			if (!elems[i * cols + j].is_zero()) { //potential pivot detected
+			if (!traits::is_zero(elems[i * cols + j])) { //potential pivot detected
 				if (elems[i * cols + j] != 1) {
 					return false;
 				}
@@ -116,7 +227,7 @@ bool matrix::is_rref() const noexcept {
 
 				if (i > 0) {
 					for (size_t k = 0; k < i - 1; k++) {
-						if (!elems[k * cols + j].is_zero()) {
+						if (!traits::is_zero(elems[k * cols + j])) {
 							return false;
 						}
 					}
@@ -134,17 +245,25 @@ bool matrix::is_rref() const noexcept {
 	return true;
 }
 
-bool MatrixExplorer::matrix::is_row_equivalent(const matrix& other) const noexcept {
+template<typename number_type>
+bool basic_matrix<number_type>::is_row_equivalent(const basic_matrix& other) const noexcept {
 	if (cols != other.cols || rows != other.rows) {
 		return false;
 	}
 
-	matrix my_rref = row_reduce();
-	matrix other_rref = other.row_reduce();
+	//telling different row spaces apart modulo a couple of primes is far cheaper than two exact rrefs
+	if constexpr (std::is_same_v<number_type, rational>) {
+		if (!randomized_row_equivalent(other)) {
+			return false;
+		}
+	}
+
+	basic_matrix my_rref = row_reduce();
+	basic_matrix other_rref = other.row_reduce();
 
 	for (size_t i = 0; i < rows; i++) {
 		for (size_t j = 0; j < cols; j++) {
-			if (my_rref.elems[i * cols + j] != other_rref.elems[i * cols + j]) {
+			if (my_rref.at(i, j) != other_rref.at(i, j)) {
 				return false;
 			}
 		}
@@ -152,30 +271,19 @@ bool MatrixExplorer::matrix::is_row_equivalent(const matrix& other) const noexce
 	return true;
 }
 
-matrix MatrixExplorer::matrix::get_row_vec(size_t index) {
-	std::vector<elem_type> elems;
-	elems.reserve(cols);
-
-	for (size_t i = 0; i < cols; i++) {
-		elems.push_back(this->elems[index * cols + i]);
-	}
-
-	return matrix(1, cols, elems);
+template<typename number_type>
+basic_matrix<number_type> basic_matrix<number_type>::get_row_vec(size_t index) {
+	return view(index, 0, 1, cols);
 }
 
-matrix MatrixExplorer::matrix::get_col_vec(size_t index) {
-	std::vector<elem_type> elems;
-	elems.reserve(rows);
-
-	for (size_t i = 0; i < rows; i++) {
-		elems.push_back(this->elems[i * cols + index]);
-	}
-
-	return matrix(rows, 1, elems);
+template<typename number_type>
+basic_matrix<number_type> basic_matrix<number_type>::get_col_vec(size_t index) {
+	return view(0, index, rows, 1);
 }
 
-std::vector<matrix> MatrixExplorer::matrix::get_rows() {
-	std::vector<matrix> row_vecs;
+template<typename number_type>
+std::vector<basic_matrix<number_type>> basic_matrix<number_type>::get_rows() {
+	std::vector<basic_matrix> row_vecs;
 	row_vecs.reserve(rows);
 
 	for (size_t i = 0; i < rows; i++) {
@@ -185,8 +293,9 @@ std::vector<matrix> MatrixExplorer::matrix::get_rows() {
 	return row_vecs;
 }
 
-std::vector<matrix> MatrixExplorer::matrix::get_cols() {
-	std::vector<matrix> col_vecs;
+template<typename number_type>
+std::vector<basic_matrix<number_type>> basic_matrix<number_type>::get_cols() {
+	std::vector<basic_matrix> col_vecs;
 	col_vecs.reserve(cols);
 
 	for (size_t i = 0; i < cols; i++) {
@@ -194,4 +303,8 @@ std::vector<matrix> MatrixExplorer::matrix::get_cols() {
 	}
 
 	return col_vecs;
-}
\ No newline at end of file
+}
+
+template class MatrixExplorer::basic_matrix<rational>;
+template class MatrixExplorer::basic_matrix<double>;
+template class MatrixExplorer::basic_matrix<prime_field>;
\ No newline at end of file
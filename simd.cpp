@@ -0,0 +1,119 @@
+#include "simd.h"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+using namespace MatrixExplorer;
+
+static void scalar_add(const double* a, const double* b, double* dest, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		dest[i] = a[i] + b[i];
+	}
+}
+
+static void scalar_subtract(const double* a, const double* b, double* dest, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		dest[i] = a[i] - b[i];
+	}
+}
+
+static void scalar_scale(double* row, double scalar, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		row[i] = row[i] * scalar;
+	}
+}
+
+static void scalar_multiply_add(double* dest, const double* src, double scalar, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		dest[i] = dest[i] + src[i] * scalar;
+	}
+}
+
+static void scalar_multiply_subtract(double* dest, const double* src, double scalar, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		dest[i] = dest[i] - src[i] * scalar;
+	}
+}
+
+static void scalar_swap(double* a, double* b, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		double temp = a[i];
+		a[i] = b[i];
+		b[i] = temp;
+	}
+}
+
+static void scalar_transpose(const double* src, size_t src_stride, double* dest, size_t dest_stride, size_t rows, size_t cols) {
+	for (size_t i = 0; i < rows; i++) {
+		for (size_t j = 0; j < cols; j++) {
+			dest[j * dest_stride + i] = src[i * src_stride + j];
+		}
+	}
+}
+
+const simd::kernels simd::scalar_kernels = {
+	"scalar",
+	scalar_add,
+	scalar_subtract,
+	scalar_scale,
+	scalar_multiply_add,
+	scalar_multiply_subtract,
+	scalar_swap,
+	scalar_transpose
+};
+
+#if defined(__x86_64__) || defined(_M_X64)
+#if defined(_MSC_VER)
+static bool os_saves_state(unsigned long long mask) {
+	return (_xgetbv(0) & mask) == mask;
+}
+
+static bool cpu_supports_avx2() {
+	int info[4];
+	__cpuid(info, 1);
+	bool has_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)); //osxsave and avx
+	if (!has_avx || !os_saves_state(0x6)) {
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return info[1] & (1 << 5);
+}
+
+static bool cpu_supports_avx512() {
+	if (!cpu_supports_avx2() || !os_saves_state(0xE6)) { //opmask and upper zmm state too
+		return false;
+	}
+
+	int info[4];
+	__cpuidex(info, 7, 0);
+	return info[1] & (1 << 16);
+}
+#else
+static bool cpu_supports_avx2() {
+	return __builtin_cpu_supports("avx2");
+}
+
+static bool cpu_supports_avx512() {
+	return __builtin_cpu_supports("avx512f");
+}
+#endif
+#endif
+
+static const simd::kernels& detect_kernels() {
+#if defined(__x86_64__) || defined(_M_X64)
+	if (cpu_supports_avx512()) {
+		return simd::avx512_kernels;
+	}
+	if (cpu_supports_avx2()) {
+		return simd::avx2_kernels;
+	}
+#endif
+	return simd::scalar_kernels;
+}
+
+const simd::kernels& simd::active() {
+	static const kernels& selected = detect_kernels();
+	return selected;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+namespace MatrixExplorer::simd {
+	//Vectorized row kernels for double precision matrices. Each instruction set gets its own table, compiled in its own
+	//translation unit with the matching target flags, and the best one the host supports is picked once at runtime.
+	//No kernel fuses a multiply and an add, so every table rounds exactly like the plain loops it replaces.
+	struct kernels {
+		const char* name;
+
+		//dest[i] = a[i] + b[i], and dest[i] = a[i] - b[i]
+		void (*add)(const double* a, const double* b, double* dest, size_t count);
+		void (*subtract)(const double* a, const double* b, double* dest, size_t count);
+
+		//row[i] = row[i] * scalar
+		void (*scale)(double* row, double scalar, size_t count);
+
+		//dest[i] = dest[i] + src[i] * scalar, and dest[i] = dest[i] - src[i] * scalar
+		void (*multiply_add)(double* dest, const double* src, double scalar, size_t count);
+		void (*multiply_subtract)(double* dest, const double* src, double scalar, size_t count);
+
+		void (*swap)(double* a, double* b, size_t count);
+
+		//dest[j * dest_stride + i] = src[i * src_stride + j] for a rows x cols block
+		void (*transpose)(const double* src, size_t src_stride, double* dest, size_t dest_stride, size_t rows, size_t cols);
+	};
+
+	extern const kernels scalar_kernels;
+#if defined(__x86_64__) || defined(_M_X64)
+	extern const kernels avx2_kernels;
+	extern const kernels avx512_kernels;
+
+	//the avx512 table shares this one
+	void avx2_transpose(const double* src, size_t src_stride, double* dest, size_t dest_stride, size_t rows, size_t cols);
+#endif
+
+	//the widest table the cpu (and os) supports
+	const kernels& active();
+}
\ No newline at end of file
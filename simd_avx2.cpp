@@ -0,0 +1,125 @@
+#include "simd.h"
+
+//compiled with avx2 enabled (see CMakeLists.txt); only ever called after simd::active() has checked for it
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+
+using namespace MatrixExplorer;
+
+static void avx2_add(const double* a, const double* b, double* dest, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm256_storeu_pd(dest + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+	}
+	for (; i < count; i++) {
+		dest[i] = a[i] + b[i];
+	}
+}
+
+static void avx2_subtract(const double* a, const double* b, double* dest, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm256_storeu_pd(dest + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+	}
+	for (; i < count; i++) {
+		dest[i] = a[i] - b[i];
+	}
+}
+
+static void avx2_scale(double* row, double scalar, size_t count) {
+	__m256d factor = _mm256_set1_pd(scalar);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm256_storeu_pd(row + i, _mm256_mul_pd(_mm256_loadu_pd(row + i), factor));
+	}
+	for (; i < count; i++) {
+		row[i] = row[i] * scalar;
+	}
+}
+
+static void avx2_multiply_add(double* dest, const double* src, double scalar, size_t count) {
+	__m256d factor = _mm256_set1_pd(scalar);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d product = _mm256_mul_pd(_mm256_loadu_pd(src + i), factor);
+		_mm256_storeu_pd(dest + i, _mm256_add_pd(_mm256_loadu_pd(dest + i), product));
+	}
+	for (; i < count; i++) {
+		dest[i] = dest[i] + src[i] * scalar;
+	}
+}
+
+static void avx2_multiply_subtract(double* dest, const double* src, double scalar, size_t count) {
+	__m256d factor = _mm256_set1_pd(scalar);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d product = _mm256_mul_pd(_mm256_loadu_pd(src + i), factor);
+		_mm256_storeu_pd(dest + i, _mm256_sub_pd(_mm256_loadu_pd(dest + i), product));
+	}
+	for (; i < count; i++) {
+		dest[i] = dest[i] - src[i] * scalar;
+	}
+}
+
+static void avx2_swap(double* a, double* b, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d a_elems = _mm256_loadu_pd(a + i);
+		_mm256_storeu_pd(a + i, _mm256_loadu_pd(b + i));
+		_mm256_storeu_pd(b + i, a_elems);
+	}
+	for (; i < count; i++) {
+		double temp = a[i];
+		a[i] = b[i];
+		b[i] = temp;
+	}
+}
+
+void simd::avx2_transpose(const double* src, size_t src_stride, double* dest, size_t dest_stride, size_t rows, size_t cols) {
+	size_t i = 0;
+	for (; i + 4 <= rows; i += 4) {
+		size_t j = 0;
+		for (; j + 4 <= cols; j += 4) {
+			//4x4 block: interleave row pairs, then swap 128 bit halves so each register holds one column
+			__m256d r0 = _mm256_loadu_pd(src + (i + 0) * src_stride + j);
+			__m256d r1 = _mm256_loadu_pd(src + (i + 1) * src_stride + j);
+			__m256d r2 = _mm256_loadu_pd(src + (i + 2) * src_stride + j);
+			__m256d r3 = _mm256_loadu_pd(src + (i + 3) * src_stride + j);
+
+			__m256d t0 = _mm256_unpacklo_pd(r0, r1);
+			__m256d t1 = _mm256_unpackhi_pd(r0, r1);
+			__m256d t2 = _mm256_unpacklo_pd(r2, r3);
+			__m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+			_mm256_storeu_pd(dest + (j + 0) * dest_stride + i, _mm256_permute2f128_pd(t0, t2, 0x20));
+			_mm256_storeu_pd(dest + (j + 1) * dest_stride + i, _mm256_permute2f128_pd(t1, t3, 0x20));
+			_mm256_storeu_pd(dest + (j + 2) * dest_stride + i, _mm256_permute2f128_pd(t0, t2, 0x31));
+			_mm256_storeu_pd(dest + (j + 3) * dest_stride + i, _mm256_permute2f128_pd(t1, t3, 0x31));
+		}
+		for (; j < cols; j++) {
+			for (size_t k = i; k < i + 4; k++) {
+				dest[j * dest_stride + k] = src[k * src_stride + j];
+			}
+		}
+	}
+	for (; i < rows; i++) {
+		for (size_t j = 0; j < cols; j++) {
+			dest[j * dest_stride + i] = src[i * src_stride + j];
+		}
+	}
+}
+
+const simd::kernels simd::avx2_kernels = {
+	"avx2",
+	avx2_add,
+	avx2_subtract,
+	avx2_scale,
+	avx2_multiply_add,
+	avx2_multiply_subtract,
+	avx2_swap,
+	avx2_transpose
+};
+#endif
\ No newline at end of file
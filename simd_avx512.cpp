@@ -0,0 +1,105 @@
+#include "simd.h"
+
+//compiled with avx512f enabled (see CMakeLists.txt); only ever called after simd::active() has checked for it
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+
+using namespace MatrixExplorer;
+
+//masks off the lanes past the end of a row, so tails don't need a scalar loop
+static __mmask8 tail_mask(size_t remaining) {
+	return static_cast<__mmask8>((1u << remaining) - 1);
+}
+
+static void avx512_add(const double* a, const double* b, double* dest, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm512_storeu_pd(dest + i, _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+	}
+	if (i < count) {
+		__mmask8 mask = tail_mask(count - i);
+		_mm512_mask_storeu_pd(dest + i, mask, _mm512_add_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i)));
+	}
+}
+
+static void avx512_subtract(const double* a, const double* b, double* dest, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm512_storeu_pd(dest + i, _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+	}
+	if (i < count) {
+		__mmask8 mask = tail_mask(count - i);
+		_mm512_mask_storeu_pd(dest + i, mask, _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i)));
+	}
+}
+
+static void avx512_scale(double* row, double scalar, size_t count) {
+	__m512d factor = _mm512_set1_pd(scalar);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm512_storeu_pd(row + i, _mm512_mul_pd(_mm512_loadu_pd(row + i), factor));
+	}
+	if (i < count) {
+		__mmask8 mask = tail_mask(count - i);
+		_mm512_mask_storeu_pd(row + i, mask, _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, row + i), factor));
+	}
+}
+
+static void avx512_multiply_add(double* dest, const double* src, double scalar, size_t count) {
+	__m512d factor = _mm512_set1_pd(scalar);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m512d product = _mm512_mul_pd(_mm512_loadu_pd(src + i), factor);
+		_mm512_storeu_pd(dest + i, _mm512_add_pd(_mm512_loadu_pd(dest + i), product));
+	}
+	if (i < count) {
+		__mmask8 mask = tail_mask(count - i);
+		__m512d product = _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, src + i), factor);
+		_mm512_mask_storeu_pd(dest + i, mask, _mm512_add_pd(_mm512_maskz_loadu_pd(mask, dest + i), product));
+	}
+}
+
+static void avx512_multiply_subtract(double* dest, const double* src, double scalar, size_t count) {
+	__m512d factor = _mm512_set1_pd(scalar);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m512d product = _mm512_mul_pd(_mm512_loadu_pd(src + i), factor);
+		_mm512_storeu_pd(dest + i, _mm512_sub_pd(_mm512_loadu_pd(dest + i), product));
+	}
+	if (i < count) {
+		__mmask8 mask = tail_mask(count - i);
+		__m512d product = _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, src + i), factor);
+		_mm512_mask_storeu_pd(dest + i, mask, _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, dest + i), product));
+	}
+}
+
+static void avx512_swap(double* a, double* b, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m512d a_elems = _mm512_loadu_pd(a + i);
+		_mm512_storeu_pd(a + i, _mm512_loadu_pd(b + i));
+		_mm512_storeu_pd(b + i, a_elems);
+	}
+	if (i < count) {
+		__mmask8 mask = tail_mask(count - i);
+		__m512d a_elems = _mm512_maskz_loadu_pd(mask, a + i);
+		_mm512_mask_storeu_pd(a + i, mask, _mm512_maskz_loadu_pd(mask, b + i));
+		_mm512_mask_storeu_pd(b + i, mask, a_elems);
+	}
+}
+
+//transposes are bound by memory rather than shuffles, so the 4x4 avx2 kernel is reused
+const simd::kernels simd::avx512_kernels = {
+	"avx512",
+	avx512_add,
+	avx512_subtract,
+	avx512_scale,
+	avx512_multiply_add,
+	avx512_multiply_subtract,
+	avx512_swap,
+	avx2_transpose
+};
+#endif
\ No newline at end of file
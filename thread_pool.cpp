@@ -0,0 +1,174 @@
+#include <algorithm>
+#include "thread_pool.h"
+
+using namespace MatrixExplorer;
+
+//set while a thread runs a chunk, so nested parallel_for calls run inline instead of waiting on the pool
+static thread_local bool in_pool_chunk = false;
+
+thread_pool::thread_pool(size_t thread_count) : queued_tasks(0), stopping(false) {
+	start_workers(thread_count);
+}
+
+thread_pool::~thread_pool() {
+	stop_workers();
+}
+
+thread_pool& thread_pool::global() {
+	static thread_pool pool(std::max<size_t>(1, std::thread::hardware_concurrency()));
+	return pool;
+}
+
+void thread_pool::set_thread_count(size_t count) {
+	std::lock_guard<std::mutex> guard(run_lock);
+
+	stop_workers();
+	start_workers(std::max<size_t>(1, count));
+}
+
+void thread_pool::start_workers(size_t count) {
+	queues.clear();
+	for (size_t i = 0; i < count; i++) {
+		queues.push_back(std::make_unique<worker_queue>());
+	}
+
+	stopping = false;
+	for (size_t slot = 1; slot < count; slot++) {
+		workers.emplace_back(&thread_pool::worker_loop, this, slot);
+	}
+}
+
+void thread_pool::stop_workers() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	work_available.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+void thread_pool::worker_loop(size_t slot) {
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			work_available.wait(guard, [this] { return stopping || queued_tasks > 0; });
+			if (stopping) {
+				return;
+			}
+		}
+
+		task taken;
+		while (try_take(slot, taken)) {
+			execute(taken);
+		}
+	}
+}
+
+bool thread_pool::try_take(size_t slot, task& taken) {
+	//own work comes off the front, in order, stolen work off the back of someone else's run
+	{
+		worker_queue& own = *queues[slot];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.tasks.empty()) {
+			taken = own.tasks.front();
+			own.tasks.pop_front();
+			queued_tasks--;
+			return true;
+		}
+	}
+
+	for (size_t i = 1; i < queues.size(); i++) {
+		worker_queue& victim = *queues[(slot + i) % queues.size()];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.tasks.empty()) {
+			taken = victim.tasks.back();
+			victim.tasks.pop_back();
+			queued_tasks--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void thread_pool::execute(const task& taken) {
+	job& owner = *taken.owner;
+	size_t lo = owner.begin + taken.chunk * owner.grain;
+	size_t hi = std::min(lo + owner.grain, owner.end);
+
+	in_pool_chunk = true;
+	try {
+		(*owner.body)(lo, hi);
+	}
+	catch (...) {
+		std::lock_guard<std::mutex> guard(owner.error_lock);
+		if (!owner.error) {
+			owner.error = std::current_exception();
+		}
+	}
+	in_pool_chunk = false;
+
+	//owner may be destroyed as soon as remaining hits zero, so only pool members are touched afterwards
+	if (--owner.remaining == 0) {
+		std::lock_guard<std::mutex> guard(lock);
+		job_finished.notify_all();
+	}
+}
+
+void thread_pool::run(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body) {
+	if (end <= begin) {
+		return;
+	}
+
+	size_t chunks = (end - begin + grain - 1) / grain;
+	if (chunks == 1 || in_pool_chunk) {
+		body(begin, end);
+		return;
+	}
+
+	std::lock_guard<std::mutex> run_guard(run_lock);
+	if (queues.size() == 1) {
+		body(begin, end);
+		return;
+	}
+
+	job current;
+	current.body = &body;
+	current.begin = begin;
+	current.end = end;
+	current.grain = grain;
+	current.remaining = chunks;
+
+	size_t slots = queues.size();
+	for (size_t slot = 0; slot < slots; slot++) {
+		worker_queue& queue = *queues[slot];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		for (size_t chunk = chunks * slot / slots; chunk < chunks * (slot + 1) / slots; chunk++) {
+			queue.tasks.push_back(task{ &current, chunk });
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		queued_tasks += chunks;
+	}
+	work_available.notify_all();
+
+	task taken;
+	while (try_take(0, taken)) {
+		execute(taken);
+	}
+
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		job_finished.wait(guard, [&current] { return current.remaining == 0; });
+	}
+
+	if (current.error) {
+		std::rethrow_exception(current.error);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MatrixExplorer {
+	//Process wide work-stealing pool for matrix kernels. A parallel_for splits an index range into chunks, deals them out
+	//in contiguous runs to one deque per thread (the calling thread included), and idle threads steal from the back of
+	//other deques. Every index is still computed by exactly the same code as the serial loop, so results are identical.
+	class thread_pool {
+	private:
+		struct job {
+			const std::function<void(size_t, size_t)>* body;
+			size_t begin, end, grain;
+			std::atomic<size_t> remaining;
+
+			std::mutex error_lock;
+			std::exception_ptr error;
+		};
+
+		struct task {
+			job* owner;
+			size_t chunk;
+		};
+
+		struct worker_queue {
+			std::mutex lock;
+			std::deque<task> tasks;
+		};
+
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<worker_queue>> queues; //queues[0] belongs to whichever thread called parallel_for
+
+		std::mutex lock;
+		std::condition_variable work_available;
+		std::condition_variable job_finished;
+		std::atomic<size_t> queued_tasks;
+		bool stopping;
+
+		std::mutex run_lock; //one parallel_for at a time
+
+		void start_workers(size_t count);
+		void stop_workers();
+
+		void worker_loop(size_t slot);
+		bool try_take(size_t slot, task& taken);
+		void execute(const task& taken);
+
+		void run(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+		thread_pool(size_t thread_count);
+	public:
+		~thread_pool();
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		static thread_pool& global();
+
+		//number of threads that run chunks, including the caller
+		size_t thread_count() const noexcept {
+			return queues.size();
+		}
+
+		void set_thread_count(size_t count);
+
+		//calls body(lo, hi) over disjoint subranges covering [begin, end), each at least grain long (except the last)
+		//ranges no longer than grain, and calls from inside a chunk, just run serially on the calling thread
+		template<typename F>
+		void parallel_for(size_t begin, size_t end, size_t grain, F&& body) {
+			if (grain == 0) {
+				grain = 1;
+			}
+
+			std::function<void(size_t, size_t)> wrapped(std::forward<F>(body));
+			run(begin, end, grain, wrapped);
+		}
+
+		//a grain that gives each chunk roughly min_chunk_work elements, for loops where each index touches work_per_index of them
+		static size_t grain_for(size_t work_per_index) noexcept {
+			return work_per_index >= min_chunk_work ? 1 : min_chunk_work / (work_per_index == 0 ? 1 : work_per_index);
+		}
+
+		static const size_t min_chunk_work = 1024;
+	};
+}
\ No newline at end of file